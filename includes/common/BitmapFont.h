@@ -0,0 +1,67 @@
+#ifndef BITMAP_FONT_H
+#define BITMAP_FONT_H
+
+// A 5x7 pixel font ('X' is set), the outlines SdfFontBuilder turns
+// into distance fields. Upper case only; layout maps lower case to it.
+struct BitmapGlyph
+{
+	char Character;
+	const char *Rows[7]; // top row first
+};
+
+static const int BitmapFontWidth = 5;
+static const int BitmapFontHeight = 7;
+
+static const BitmapGlyph BitmapFont[] = {
+	{ '0', { ".XXX.", "X...X", "X..XX", "X.X.X", "XX..X", "X...X", ".XXX." } },
+	{ '1', { "..X..", ".XX..", "..X..", "..X..", "..X..", "..X..", ".XXX." } },
+	{ '2', { ".XXX.", "X...X", "....X", "...X.", "..X..", ".X...", "XXXXX" } },
+	{ '3', { "XXXXX", "...X.", "..X..", "...X.", "....X", "X...X", ".XXX." } },
+	{ '4', { "...X.", "..XX.", ".X.X.", "X..X.", "XXXXX", "...X.", "...X." } },
+	{ '5', { "XXXXX", "X....", "XXXX.", "....X", "....X", "X...X", ".XXX." } },
+	{ '6', { "..XX.", ".X...", "X....", "XXXX.", "X...X", "X...X", ".XXX." } },
+	{ '7', { "XXXXX", "....X", "...X.", "..X..", ".X...", ".X...", ".X..." } },
+	{ '8', { ".XXX.", "X...X", "X...X", ".XXX.", "X...X", "X...X", ".XXX." } },
+	{ '9', { ".XXX.", "X...X", "X...X", ".XXXX", "....X", "...X.", ".XX.." } },
+	{ 'A', { ".XXX.", "X...X", "X...X", "X...X", "XXXXX", "X...X", "X...X" } },
+	{ 'B', { "XXXX.", "X...X", "X...X", "XXXX.", "X...X", "X...X", "XXXX." } },
+	{ 'C', { ".XXX.", "X...X", "X....", "X....", "X....", "X...X", ".XXX." } },
+	{ 'D', { "XXX..", "X..X.", "X...X", "X...X", "X...X", "X..X.", "XXX.." } },
+	{ 'E', { "XXXXX", "X....", "X....", "XXXX.", "X....", "X....", "XXXXX" } },
+	{ 'F', { "XXXXX", "X....", "X....", "XXXX.", "X....", "X....", "X...." } },
+	{ 'G', { ".XXX.", "X...X", "X....", "X.XXX", "X...X", "X...X", ".XXXX" } },
+	{ 'H', { "X...X", "X...X", "X...X", "XXXXX", "X...X", "X...X", "X...X" } },
+	{ 'I', { ".XXX.", "..X..", "..X..", "..X..", "..X..", "..X..", ".XXX." } },
+	{ 'J', { "..XXX", "...X.", "...X.", "...X.", "...X.", "X..X.", ".XX.." } },
+	{ 'K', { "X...X", "X..X.", "X.X..", "XX...", "X.X..", "X..X.", "X...X" } },
+	{ 'L', { "X....", "X....", "X....", "X....", "X....", "X....", "XXXXX" } },
+	{ 'M', { "X...X", "XX.XX", "X.X.X", "X.X.X", "X...X", "X...X", "X...X" } },
+	{ 'N', { "X...X", "X...X", "XX..X", "X.X.X", "X..XX", "X...X", "X...X" } },
+	{ 'O', { ".XXX.", "X...X", "X...X", "X...X", "X...X", "X...X", ".XXX." } },
+	{ 'P', { "XXXX.", "X...X", "X...X", "XXXX.", "X....", "X....", "X...." } },
+	{ 'Q', { ".XXX.", "X...X", "X...X", "X...X", "X.X.X", "X..X.", ".XX.X" } },
+	{ 'R', { "XXXX.", "X...X", "X...X", "XXXX.", "X.X..", "X..X.", "X...X" } },
+	{ 'S', { ".XXXX", "X....", "X....", ".XXX.", "....X", "....X", "XXXX." } },
+	{ 'T', { "XXXXX", "..X..", "..X..", "..X..", "..X..", "..X..", "..X.." } },
+	{ 'U', { "X...X", "X...X", "X...X", "X...X", "X...X", "X...X", ".XXX." } },
+	{ 'V', { "X...X", "X...X", "X...X", "X...X", "X...X", ".X.X.", "..X.." } },
+	{ 'W', { "X...X", "X...X", "X...X", "X.X.X", "X.X.X", "X.X.X", ".X.X." } },
+	{ 'X', { "X...X", "X...X", ".X.X.", "..X..", ".X.X.", "X...X", "X...X" } },
+	{ 'Y', { "X...X", "X...X", ".X.X.", "..X..", "..X..", "..X..", "..X.." } },
+	{ 'Z', { "XXXXX", "....X", "...X.", "..X..", ".X...", "X....", "XXXXX" } },
+	{ '.', { ".....", ".....", ".....", ".....", ".....", ".XX..", ".XX.." } },
+	{ ',', { ".....", ".....", ".....", ".....", ".XX..", "..X..", ".X..." } },
+	{ ':', { ".....", ".XX..", ".XX..", ".....", ".XX..", ".XX..", "....." } },
+	{ '!', { "..X..", "..X..", "..X..", "..X..", "..X..", ".....", "..X.." } },
+	{ '?', { ".XXX.", "X...X", "....X", "...X.", "..X..", ".....", "..X.." } },
+	{ '-', { ".....", ".....", ".....", "XXXXX", ".....", ".....", "....." } },
+	{ '+', { ".....", "..X..", "..X..", "XXXXX", "..X..", "..X..", "....." } },
+	{ '=', { ".....", ".....", "XXXXX", ".....", "XXXXX", ".....", "....." } },
+	{ '/', { ".....", "....X", "...X.", "..X..", ".X...", "X....", "....." } },
+	{ '(', { "...X.", "..X..", ".X...", ".X...", ".X...", "..X..", "...X." } },
+	{ ')', { ".X...", "..X..", "...X.", "...X.", "...X.", "..X..", ".X..." } },
+	{ '%', { "XX...", "XX..X", "...X.", "..X..", ".X...", "X..XX", "...XX" } },
+	{ '\'', { "..X..", "..X..", ".X...", ".....", ".....", ".....", "....." } },
+};
+
+#endif
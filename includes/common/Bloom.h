@@ -0,0 +1,177 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <common/GLState.h>
+#include <common/GpuProfiler.h>
+#include <common/RenderTarget.h>
+#include <common/Shader.h>
+
+// Bloom makes the bright parts of a frame glow. The pixels above
+// Threshold are extracted into a target Resolution times the frame size
+// (half by default), which is halved Passes more times with the dual
+// filter (Kawase) downsample; the upsample then walks back up, adding
+// every level to the next larger one, and the sum is added onto the
+// frame scaled by Intensity. Each step reads 5 to 8 bilinear taps of a
+// small target and the composite a single one, so the only full
+// resolution work is one read and one blended write per pixel. Works
+// on any frame, but only an HDR (e.g. GL_RGBA16F) frame keeps the
+// highlights above 1 that make the glow grow with brightness. Every
+// pass is timed by a GpuProfiler scope ("bloom_*").
+class Bloom
+{
+public:
+	// Pyramid levels below the bright pass at most
+	static const GLuint MaxPasses = 8;
+	// Off switch; Apply() does nothing while false
+	GLboolean Enabled;
+	// Size of the bright pass relative to the frame, and downsample passes below it
+	GLfloat Resolution;
+	GLuint Passes;
+	// Brightness (largest channel) where the glow starts, softened over Knee either way
+	GLfloat Threshold, Knee;
+	// Strength of the glow added to the frame
+	GLfloat Intensity;
+	// Constructor (the programs are bloom_extract.fs, bloom_down.fs, bloom_up.fs and bloom_composite.fs
+	// linked with the full-screen upscale.vs)
+	Bloom(Shader extract, Shader downsample, Shader upsample, Shader composite)
+		: Enabled(GL_TRUE), Resolution(0.5f), Passes(5), Threshold(1.0f), Knee(0.25f), Intensity(0.8f),
+		  extract(extract), downsample(downsample), upsample(upsample), composite(composite), used(0), frameWidth(0), frameHeight(0), allocatedResolution(0.0f)
+	{
+		glGenVertexArrays(1, &this->emptyVAO);
+		for (GLuint i = 0; i <= MaxPasses; ++i)
+		{
+			this->downScopes.push_back("bloom_down_" + std::to_string(i));
+			this->upScopes.push_back("bloom_up_" + std::to_string(i));
+		}
+	}
+	Bloom(const Bloom&) = delete;
+	Bloom &operator=(const Bloom&) = delete;
+	// Destructor
+	~Bloom()
+	{
+		glDeleteVertexArrays(1, &this->emptyVAO);
+		GLState::ForgetVertexArray(this->emptyVAO);
+		for (size_t i = 0; i < this->levels.size(); ++i)
+			delete this->levels[i];
+	}
+	// Adds the glow of frame's color onto frame itself; leaves frame bound with blending enabled
+	void Apply(const RenderTarget &frame)
+	{
+		if (!this->Enabled || !this->extract.Ready() || !this->downsample.Ready() || !this->upsample.Ready() || !this->composite.Ready())
+			return;
+		GLuint count = this->allocate(frame.Width, frame.Height);
+		if (count == 0)
+			return;
+		GpuScope scope("bloom");
+		GLState::Disable(GL_BLEND);
+		GLState::BindVertexArray(this->emptyVAO);
+		{
+			GpuScope pass("bloom_extract");
+			this->extract.Use();
+			this->extract.SetInteger("image", 0);
+			this->extract.SetVector2f("halfPixel", halfPixel(*this->levels[0]));
+			this->extract.SetFloat("threshold", this->Threshold);
+			this->extract.SetFloat("knee", this->Knee);
+			this->draw(frame, *this->levels[0]);
+		}
+		this->downsample.Use();
+		this->downsample.SetInteger("image", 0);
+		for (GLuint i = 1; i < count; ++i)
+		{
+			GpuScope pass(this->downScopes[i]);
+			this->downsample.SetVector2f("halfPixel", halfPixel(*this->levels[i]));
+			this->draw(*this->levels[i - 1], *this->levels[i]);
+		}
+		// each level keeps its own blur and receives the smaller ones on top
+		GLState::Enable(GL_BLEND);
+		GLState::BlendFunc(GL_ONE, GL_ONE);
+		this->upsample.Use();
+		this->upsample.SetInteger("image", 0);
+		for (GLuint i = count - 1; i > 0; --i)
+		{
+			GpuScope pass(this->upScopes[i - 1]);
+			this->upsample.SetVector2f("halfPixel", halfPixel(*this->levels[i - 1]));
+			this->draw(*this->levels[i], *this->levels[i - 1]);
+		}
+		{
+			GpuScope pass("bloom_composite");
+			this->composite.Use();
+			this->composite.SetInteger("image", 0);
+			this->composite.SetFloat("intensity", this->Intensity);
+			this->draw(*this->levels[0], frame);
+		}
+		GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	// Levels in use (the bright pass and the downsampled ones), valid after Apply()
+	GLuint Levels() const
+	{
+		return this->used;
+	}
+private:
+	Shader extract, downsample, upsample, composite;
+	GLuint emptyVAO;
+	// Pyramid: the bright pass, then every downsample; allocated up to the largest pass count used
+	std::vector<RenderTarget*> levels;
+	GLuint used;
+	GLuint frameWidth, frameHeight;
+	GLfloat allocatedResolution;
+	std::vector<std::string> downScopes, upScopes;
+	// Sizes the pyramid for a frame, returns the number of levels to use
+	GLuint allocate(GLuint width, GLuint height)
+	{
+		if (width != this->frameWidth || height != this->frameHeight || this->Resolution != this->allocatedResolution)
+		{
+			for (size_t i = 0; i < this->levels.size(); ++i)
+				delete this->levels[i];
+			this->levels.clear();
+			this->frameWidth = width;
+			this->frameHeight = height;
+			this->allocatedResolution = this->Resolution;
+		}
+		GLuint levelWidth = std::max(1, (GLint)std::floor(width * this->Resolution + 0.5f));
+		GLuint levelHeight = std::max(1, (GLint)std::floor(height * this->Resolution + 0.5f));
+		GLuint count = 0;
+		// a level smaller than 2x2 has nothing left to blur
+		while (count <= std::min(this->Passes, MaxPasses) && (count == 0 || (levelWidth > 1 && levelHeight > 1)))
+		{
+			if (count > 0)
+			{
+				levelWidth = std::max(1u, levelWidth / 2);
+				levelHeight = std::max(1u, levelHeight / 2);
+			}
+			if (count == this->levels.size())
+			{
+				RenderTarget *level = new RenderTarget();
+				// half the bandwidth of RGBA16F, no alpha is needed
+				level->Color.Internal_Format = GL_R11F_G11F_B10F;
+				level->Color.Image_Format = GL_RGB;
+				level->Generate(levelWidth, levelHeight);
+				this->levels.push_back(level);
+			}
+			count++;
+		}
+		this->used = count;
+		return count;
+	}
+	// Draws a full-screen triangle into target sampling source
+	void draw(const RenderTarget &source, const RenderTarget &target)
+	{
+		target.Bind();
+		GLState::BindTexture(0, GL_TEXTURE_2D, source.Color.ID);
+		glDrawArrays(GL_TRIANGLES, 0, 3);
+	}
+	// Offset of the filter taps: half a pixel of the target, in texture coordinates
+	static glm::vec2 halfPixel(const RenderTarget &target)
+	{
+		return glm::vec2(0.5f / target.Width, 0.5f / target.Height);
+	}
+};
+
+#endif
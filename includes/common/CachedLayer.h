@@ -0,0 +1,74 @@
+#ifndef CACHED_LAYER_H
+#define CACHED_LAYER_H
+
+#include <common/RenderTarget.h>
+
+// CachedLayer keeps static content (background, level geometry) in an
+// offscreen RenderTarget. The content is only redrawn after
+// Invalidate(), every other frame Composite() copies it to the screen
+// with a single blit, whatever it cost to draw. Typical use:
+//
+//     if (layer.BeginUpdate()) { ...draw...; layer.EndUpdate(0, viewport); }
+//     layer.Composite(0, viewport);
+class CachedLayer
+{
+public:
+	// Statistics: how often the content had to be redrawn and how often it was reused
+	GLuint Updates, Reuses;
+	// Constructor
+	CachedLayer() : Updates(0), Reuses(0), dirty(GL_TRUE) { }
+	// Allocates the layer (format as for the frame it is composited into), its content is redrawn on the next BeginUpdate
+	void Generate(GLuint width, GLuint height, GLenum format = GL_RGBA8)
+	{
+		this->target.Color.Internal_Format = format;
+		this->target.Generate(width, height);
+		this->dirty = GL_TRUE;
+	}
+	// Marks the content as outdated
+	void Invalidate()
+	{
+		this->dirty = GL_TRUE;
+	}
+	GLboolean IsDirty() const
+	{
+		return this->dirty;
+	}
+	// Binds the layer for drawing if its content is outdated; returns false when the cache is valid
+	bool BeginUpdate()
+	{
+		if (!this->dirty)
+		{
+			this->Reuses++;
+			return false;
+		}
+		this->target.Bind();
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+		return true;
+	}
+	// Finishes drawing the content and returns to framebuffer with the given viewport
+	void EndUpdate(GLuint framebuffer, glm::ivec4 viewport)
+	{
+		this->dirty = GL_FALSE;
+		this->Updates++;
+		GLState::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		GLState::Viewport(viewport.x, viewport.y, viewport.z, viewport.w);
+	}
+	// Copies the cached content over the given viewport of framebuffer
+	void Composite(GLuint framebuffer, glm::ivec4 viewport) const
+	{
+		GLenum filter = (GLint)this->target.Width == viewport.z && (GLint)this->target.Height == viewport.w ? GL_NEAREST : GL_LINEAR;
+		this->target.BlitTo(framebuffer, viewport.x, viewport.y, viewport.z, viewport.w, filter);
+		GLState::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	}
+	// Render target holding the content
+	const RenderTarget &Target() const
+	{
+		return this->target;
+	}
+private:
+	RenderTarget target;
+	GLboolean dirty;
+};
+
+#endif
@@ -0,0 +1,127 @@
+#ifndef COMMAND_LIST_H
+#define COMMAND_LIST_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <common/Texture.h>
+#include <common/SpriteTransform.h>
+#include <common/TextureAtlas.h>
+#include <common/TextureArray.h>
+#include <common/SpriteShape.h>
+
+// How a sprite is blended. Opaque and cutout sprites are drawn first,
+// front to back with depth testing and without blending (cutout ones
+// discard pixels below the alpha cutoff); translucent sprites are
+// blended afterwards, back to front.
+enum SpriteMaterial
+{
+	MaterialOpaque,
+	MaterialCutout,
+	MaterialTranslucent
+};
+
+// A fully prepared sprite draw: sort key, resources and the already
+// computed transform. Only a SpriteBatch on the GL thread has to
+// expand it into vertices.
+struct DrawPacket
+{
+	uint64_t Key;
+	GLenum Target; // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or SpriteShape::Target
+	GLuint Texture, Layer; // for shapes no texture, and the packed shape as layer
+	glm::vec4 UV;
+	glm::vec3 Color;
+	SpriteAffine Affine;
+	GLfloat Depth; // window depth derived from layer and depth, smaller is nearer
+};
+
+// CommandList records DrawPackets without touching OpenGL, so any
+// thread can fill one (one list per thread, lists are not shared).
+// Keys and transforms are computed while recording; a RenderQueue on
+// the GL thread merges the lists, sorts them and replays them.
+class CommandList
+{
+public:
+	// Constructor
+	CommandList() { }
+	// Drops all recorded packets, keeping the memory
+	void Reset()
+	{
+		this->packets.clear();
+	}
+	void Reserve(size_t count)
+	{
+		this->packets.reserve(count);
+	}
+	// Records a sprite; same parameters as SpriteBatch::DrawSprite after the sort fields
+	void Draw(GLuint layer, SpriteMaterial material, GLfloat depth, const Texture2D &texture, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->DrawAffine(layer, material, depth, GL_TEXTURE_2D, texture.ID, 0, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), SpriteTransform::Compose(position, size, rotate, yRot), color);
+	}
+	void Draw(GLuint layer, SpriteMaterial material, GLfloat depth, const AtlasRegion &region, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->DrawAffine(layer, material, depth, GL_TEXTURE_2D, region.TextureID, 0, region.UV, SpriteTransform::Compose(position, size, rotate, yRot), color);
+	}
+	void Draw(GLuint layer, SpriteMaterial material, GLfloat depth, const TextureLayer &textureLayer, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->DrawAffine(layer, material, depth, GL_TEXTURE_2D_ARRAY, textureLayer.ArrayID, textureLayer.Layer, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), SpriteTransform::Compose(position, size, rotate, yRot), color);
+	}
+	void Draw(GLuint layer, SpriteMaterial material, GLfloat depth, const SpriteShape &shape, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->DrawAffine(layer, material, depth, SpriteShape::Target, 0, shape.Packed(), SpriteShape::UV(), SpriteTransform::Compose(position, size, rotate, yRot), color);
+	}
+	// Records a sprite whose transform was computed by the caller (e.g. with SpriteTransform::ComputeAffines)
+	void DrawAffine(GLuint layer, SpriteMaterial material, GLfloat depth, GLenum target, GLuint texture, GLuint textureLayer, glm::vec4 uvRect, const SpriteAffine &affine, glm::vec3 color)
+	{
+		// SpriteBatch uses one program per texture target
+		GLuint shader = target == GL_TEXTURE_2D_ARRAY ? 1 : target == SpriteShape::Target ? 2 : 0;
+		DrawPacket packet = { MakeKey(layer, material, shader, texture, depth), target, texture, textureLayer, uvRect, color, affine, WindowDepth(layer, depth) };
+		this->packets.push_back(packet);
+	}
+	// Recorded packets in recording order
+	const std::vector<DrawPacket> &Packets() const
+	{
+		return this->packets;
+	}
+	size_t Size() const
+	{
+		return this->packets.size();
+	}
+	// Builds the sort key of a draw:
+	//
+	//     opaque, cutout: 0 | cutout:1 | shader:6 | texture:24 | front-to-back order:32
+	//     translucent:    1 | back-to-front order:32 | shader:7 | texture:24
+	//
+	// where the order is made of the layer (8 bits, higher is nearer) and the depth within
+	// the layer (24 bits, in [0, 1], 0 being nearest).
+	static uint64_t MakeKey(GLuint layer, SpriteMaterial material, GLuint shader, GLuint texture, GLfloat depth)
+	{
+		const uint64_t depthMask = 0xFFFFFF;
+		uint64_t depthBits = (uint64_t)(glm::clamp(depth, 0.0f, 1.0f) * (GLfloat)depthMask);
+		uint64_t layerBits = layer & 0xFF;
+		if (material != MaterialTranslucent)
+		{
+			uint64_t frontToBack = (0xFF - layerBits) << 24 | depthBits;
+			return (uint64_t)(material == MaterialCutout) << 62 | (uint64_t)(shader & 0x3F) << 56 | (uint64_t)(texture & 0xFFFFFF) << 32 | frontToBack;
+		}
+		uint64_t backToFront = layerBits << 24 | (depthMask - depthBits);
+		return (uint64_t)1 << 63 | backToFront << 31 | (uint64_t)(shader & 0x7F) << 24 | (uint64_t)(texture & 0xFFFFFF);
+	}
+	// True if key belongs to the translucent pass
+	static bool IsTranslucent(uint64_t key)
+	{
+		return (key >> 63) != 0;
+	}
+	// Window depth of a sprite: layers occupy consecutive slices of [0, 1], the highest
+	// layer nearest, with a small gap so a layer never touches the next one
+	static GLfloat WindowDepth(GLuint layer, GLfloat depth)
+	{
+		return ((GLfloat)(0xFF - (layer & 0xFF)) + glm::clamp(depth, 0.0f, 1.0f) * 0.99f) / 256.0f;
+	}
+private:
+	std::vector<DrawPacket> packets;
+};
+
+#endif
@@ -0,0 +1,160 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <algorithm>
+#include <cmath>
+
+#include <glm/glm.hpp>
+
+#include <common/GLState.h>
+#include <common/GpuProfiler.h>
+#include <common/RenderTarget.h>
+#include <common/Shader.h>
+
+// DynamicResolution renders the scene into an internal RenderTarget
+// whose size is a fraction (Scale) of the output rectangle, then
+// upscales it to the window. The GPU time of the scene is measured by
+// the GpuProfiler scope "scene"; when its average exceeds
+// TargetMilliseconds the scale drops, when there is enough headroom it
+// grows again, always within [MinScale, MaxScale]. Typical use:
+//
+//     resolution.Begin(output);   // binds the internal target
+//     ...clear and draw...
+//     resolution.End(0);          // upscales into the default framebuffer
+class DynamicResolution
+{
+public:
+	// Bounds of the scale applied to the output size
+	GLfloat MinScale, MaxScale;
+	// GPU time per frame the scale is adjusted for
+	GLfloat TargetMilliseconds;
+	// Upscale filter: 0 is a plain bilinear blit, above 0 a sharpening pass of that strength
+	GLfloat Sharpness;
+	// Internal format of the internal target, e.g. GL_RGBA16F to keep values above 1 for post-processing
+	GLenum ColorFormat;
+	// Current scale and smoothed GPU milliseconds of the scene
+	GLfloat Scale;
+	GLfloat GpuMilliseconds;
+	// Statistics: internal target reallocations and frames rendered below full scale
+	GLuint Resizes, ScaledFrames, Frames;
+	// Constructor (upscale is the upscale.vs/upscale.fs shader)
+	DynamicResolution(Shader upscale, GLfloat minScale = 0.5f, GLfloat maxScale = 1.0f, GLfloat targetMilliseconds = 12.0f)
+		: MinScale(minScale), MaxScale(maxScale), TargetMilliseconds(targetMilliseconds), Sharpness(0.0f), ColorFormat(GL_RGBA8),
+		  Scale(maxScale), GpuMilliseconds(0.0f), Resizes(0), ScaledFrames(0), Frames(0),
+		  shader(upscale), output(0), samplesSeen(0), samplesSinceChange(0)
+	{
+		glGenVertexArrays(1, &this->emptyVAO);
+	}
+	DynamicResolution(const DynamicResolution&) = delete;
+	DynamicResolution &operator=(const DynamicResolution&) = delete;
+	// Destructor
+	~DynamicResolution()
+	{
+		glDeleteVertexArrays(1, &this->emptyVAO);
+		GLState::ForgetVertexArray(this->emptyVAO);
+	}
+	// Sizes the internal target for the output rectangle (window pixels), binds it and starts timing
+	void Begin(glm::ivec4 output)
+	{
+		this->output = output;
+		GLuint width = std::max(1, (GLint)std::floor(output.z * this->Scale + 0.5f));
+		GLuint height = std::max(1, (GLint)std::floor(output.w * this->Scale + 0.5f));
+		if (width != this->target.Width || height != this->target.Height || this->ColorFormat != this->target.Color.Internal_Format)
+		{
+			this->target.Color.Internal_Format = this->ColorFormat;
+			this->target.Generate(width, height, GL_TRUE);
+			this->Resizes++;
+		}
+		this->target.Bind();
+		GpuProfiler::Begin("scene");
+	}
+	// Stops timing and upscales the internal target into the output rectangle of framebuffer
+	void End(GLuint framebuffer)
+	{
+		GpuProfiler::End();
+		this->Frames++;
+		if (this->target.Width != (GLuint)this->output.z || this->target.Height != (GLuint)this->output.w)
+			this->ScaledFrames++;
+		GpuScope scope("upscale");
+		// the sharpening program may still be compiling, the blit stands in for it
+		if (this->Sharpness <= 0.0f || !this->shader.Ready())
+		{
+			this->target.BlitTo(framebuffer, this->output.x, this->output.y, this->output.z, this->output.w, GL_LINEAR);
+			GLState::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			GLState::Viewport(this->output.x, this->output.y, this->output.z, this->output.w);
+		}
+		else
+		{
+			GLState::BindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			GLState::Viewport(this->output.x, this->output.y, this->output.z, this->output.w);
+			GLState::Disable(GL_BLEND);
+			if (!this->sharpnessUniform.Valid())
+			{
+				this->sharpnessUniform = this->shader.GetUniform("sharpness");
+				this->shader.Use().SetInteger("image", 0);
+			}
+			this->shader.Use();
+			this->shader.SetFloat(this->sharpnessUniform, this->Sharpness);
+			GLState::BindTexture(0, GL_TEXTURE_2D, this->target.Color.ID);
+			GLState::BindVertexArray(this->emptyVAO);
+			glDrawArrays(GL_TRIANGLES, 0, 3);
+			GLState::Enable(GL_BLEND);
+		}
+		this->adjust();
+	}
+	// Framebuffer and viewport of the internal target, valid between Begin and End
+	GLuint Framebuffer() const
+	{
+		return this->target.ID;
+	}
+	glm::ivec4 Viewport() const
+	{
+		return glm::ivec4(0, 0, this->target.Width, this->target.Height);
+	}
+	// The internal target, e.g. for post-processing before End()
+	const RenderTarget &Target() const
+	{
+		return this->target;
+	}
+private:
+	// Samples to wait after a change before the next one, so the new size gets measured first
+	static const GLuint SettleSamples = 8;
+	// The scale only grows while the GPU time stays below this fraction of the target
+	static constexpr GLfloat Headroom = 0.75f;
+	// Scales are multiples of this step so small jitter does not reallocate the target
+	static constexpr GLfloat ScaleStep = 0.05f;
+	RenderTarget target;
+	Shader shader;
+	UniformHandle sharpnessUniform;
+	GLuint emptyVAO;
+	glm::ivec4 output;
+	GLuint samplesSeen, samplesSinceChange;
+	// Follows the scene time once new samples arrived from the profiler
+	void adjust()
+	{
+		GpuProfiler::Summary scene = GpuProfiler::Get("scene");
+		if (scene.Samples == this->samplesSeen)
+			return;
+		this->samplesSinceChange += scene.Samples - this->samplesSeen;
+		this->samplesSeen = scene.Samples;
+		// the profiler's average spans older scales, follow the latest samples instead
+		this->GpuMilliseconds = this->GpuMilliseconds == 0.0f ? scene.Last : this->GpuMilliseconds * 0.8f + scene.Last * 0.2f;
+		if (this->samplesSinceChange < SettleSamples)
+			return;
+		// GPU time grows with the pixel count, i.e. with the square of the scale
+		GLfloat scale = this->Scale;
+		if (this->GpuMilliseconds > this->TargetMilliseconds)
+			scale = std::floor(scale * std::sqrt(this->TargetMilliseconds / this->GpuMilliseconds) / ScaleStep) * ScaleStep;
+		else if (this->GpuMilliseconds < this->TargetMilliseconds * Headroom)
+			scale = std::floor(scale / ScaleStep + 1.5f) * ScaleStep;
+		scale = std::min(this->MaxScale, std::max(this->MinScale, scale));
+		if (scale != this->Scale)
+		{
+			this->Scale = scale;
+			this->samplesSinceChange = 0;
+			this->GpuMilliseconds = 0.0f;
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,72 @@
+#ifndef FIXED_TIMESTEP_H
+#define FIXED_TIMESTEP_H
+
+#include <algorithm>
+#include <chrono>
+
+// FixedTimestep decouples the simulation rate from the frame rate. The
+// real time elapsed since the previous Advance() (steady_clock) goes
+// into an accumulator that is drained in ticks of exactly Step seconds,
+// so the simulation is identical at 30 or 240 frames per second. The
+// remainder, as a fraction of a tick, is the Alpha() used to
+// interpolate between the last two simulation states when drawing.
+// Frames longer than MaxFrameSeconds (debugger, window drag) are
+// clamped, otherwise the catch-up ticks would make the next frame even
+// longer. Typical use:
+//
+//     for (unsigned ticks = timestep.Advance(); ticks > 0; --ticks) { previous = state; simulate(state); }
+//     draw(interpolate(previous, state, timestep.Alpha()));
+class FixedTimestep
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	// Length of a tick and the longest frame simulated in full, in seconds
+	const GLdouble Step;
+	GLdouble MaxFrameSeconds;
+	// Statistics: ticks run and simulated time dropped by the clamp
+	GLuint Ticks;
+	GLdouble DroppedSeconds;
+	// Constructor (hz ticks per second)
+	explicit FixedTimestep(GLdouble hz)
+		: Step(1.0 / hz), MaxFrameSeconds(0.25), Ticks(0), DroppedSeconds(0.0), accumulator(0.0), started(false)
+	{
+	}
+	// Adds the time since the last call and returns the number of ticks to simulate now
+	GLuint Advance()
+	{
+		Clock::time_point now = Clock::now();
+		if (!this->started)
+		{
+			this->last = now;
+			this->started = true;
+		}
+		GLdouble elapsed = std::chrono::duration<GLdouble>(now - this->last).count();
+		this->last = now;
+		return this->Advance(elapsed);
+	}
+	// Same with a given frame time instead of the clock, for reproducible runs
+	GLuint Advance(GLdouble elapsed)
+	{
+		if (elapsed > this->MaxFrameSeconds)
+		{
+			this->DroppedSeconds += elapsed - this->MaxFrameSeconds;
+			elapsed = this->MaxFrameSeconds;
+		}
+		this->accumulator += elapsed;
+		GLuint ticks = (GLuint)(this->accumulator / this->Step);
+		this->accumulator -= ticks * this->Step;
+		this->Ticks += ticks;
+		return ticks;
+	}
+	// Fraction of a tick accumulated but not simulated yet, in [0, 1)
+	GLfloat Alpha() const
+	{
+		return (GLfloat)std::min(1.0, this->accumulator / this->Step);
+	}
+private:
+	GLdouble accumulator;
+	Clock::time_point last;
+	bool started;
+};
+
+#endif
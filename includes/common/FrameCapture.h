@@ -0,0 +1,293 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <common/GLState.h>
+#include <common/PngWriter.h>
+#include <common/RenderTarget.h>
+
+// Output of a FrameCapture
+enum CaptureFormat
+{
+	CapturePng, // <path>_00001.png, <path>_00002.png, ...
+	CaptureY4m, // one YUV4MPEG2 stream, 4:2:0, plays in mpv and ffmpeg
+	CaptureRaw  // one stream of RGBA frames, top row first (ffmpeg -f rawvideo -pix_fmt rgba -s WxH)
+};
+
+// FrameCapture records frames without stalling the renderer. Capture()
+// scales the presented rectangle into a fixed size target and starts a
+// glReadPixels into one of Buffers pixel-pack buffers: with a buffer
+// bound the read returns at once and the copy happens on the GPU. A
+// fence marks when it is done; buffers are mapped a few frames later,
+// once their fence signalled, and the pixels go to a writer thread that
+// encodes and writes them. When every buffer is still in flight, or the
+// writer is QueueLimit frames behind, the frame is dropped instead of
+// waiting. Overhead is the time Capture() takes on the render thread.
+class FrameCapture
+{
+public:
+	// Size of the captured frames and the frame rate written into video headers
+	const GLuint Width, Height;
+	const GLuint Fps;
+	const CaptureFormat Format;
+	// Frames the writer may fall behind before new ones are dropped
+	GLuint QueueLimit;
+	// Statistics: frames captured (written or queued), dropped, and time spent
+	GLuint Captured, Dropped;
+	GLdouble OverheadMilliseconds; // on the render thread
+	GLdouble WriteMilliseconds;    // on the writer thread, encoding included
+	// Constructor (path is the file, or the file name prefix for PNG sequences)
+	FrameCapture(const std::string &path, CaptureFormat format, GLuint width, GLuint height, GLuint fps = 60, GLuint buffers = 3)
+		: Width(width), Height(height), Fps(fps), Format(format), QueueLimit(8),
+		  Captured(0), Dropped(0), OverheadMilliseconds(0.0), WriteMilliseconds(0.0),
+		  path(path), file(NULL), slots(buffers), next(0), frames(0), written(0), stopping(false)
+	{
+		this->target.Generate(width, height);
+		for (size_t i = 0; i < this->slots.size(); ++i)
+		{
+			glGenBuffers(1, &this->slots[i].Buffer);
+			GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, this->slots[i].Buffer);
+			glBufferData(GL_PIXEL_PACK_BUFFER, this->frameBytes(), NULL, GL_STREAM_READ);
+		}
+		GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		if (format != CapturePng)
+		{
+			this->file = std::fopen(path.c_str(), "wb");
+			if (!this->file)
+				std::cout << "ERROR::CAPTURE: cannot open " << path << std::endl;
+			else if (format == CaptureY4m)
+				std::fprintf(this->file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C420jpeg\n", width, height, fps);
+		}
+		this->writer = std::thread(&FrameCapture::run, this);
+	}
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture &operator=(const FrameCapture&) = delete;
+	// Destructor (writes the frames still in flight)
+	~FrameCapture()
+	{
+		this->Finish();
+		for (size_t i = 0; i < this->slots.size(); ++i)
+		{
+			glDeleteBuffers(1, &this->slots[i].Buffer);
+			GLState::ForgetBuffer(this->slots[i].Buffer);
+		}
+	}
+	// Captures the viewport rectangle (x, y, width, height) of framebuffer, call after the frame is drawn
+	void Capture(GLuint framebuffer, const glm::ivec4 &viewport)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		this->collect(false);
+		Slot &slot = this->slots[this->next];
+		if (slot.Fence || this->queued() >= this->QueueLimit)
+			this->Dropped++;
+		else
+		{
+			GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+			GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, this->target.ID);
+			glBlitFramebuffer(viewport.x, viewport.y, viewport.x + viewport.z, viewport.y + viewport.w,
+			                  0, 0, this->Width, this->Height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+			GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, this->target.ID);
+			GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+			glPixelStorei(GL_PACK_ALIGNMENT, 1);
+			glReadPixels(0, 0, this->Width, this->Height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+			GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			slot.Frame = this->frames++;
+			this->next = (this->next + 1) % this->slots.size();
+			this->Captured++;
+		}
+		this->OverheadMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+	// Waits for the buffers in flight and the writer, then closes the output; later captures are ignored
+	void Finish()
+	{
+		if (!this->writer.joinable())
+			return;
+		this->collect(true);
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+		this->wake.notify_all();
+		this->writer.join();
+		if (this->file)
+			std::fclose(this->file);
+		this->file = NULL;
+	}
+	// Frames written to disk so far
+	GLuint Written()
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return this->written;
+	}
+private:
+	struct Slot
+	{
+		GLuint Buffer;
+		GLsync Fence; // set while the read is in flight
+		GLuint Frame;
+		Slot() : Buffer(0), Fence((GLsync)0), Frame(0) { }
+	};
+	struct Pending
+	{
+		GLuint Frame;
+		std::vector<unsigned char> Pixels; // bottom row first, as read
+	};
+	std::string path;
+	FILE *file;
+	RenderTarget target;
+	std::vector<Slot> slots;
+	size_t next;
+	GLuint frames;
+	std::thread writer;
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::deque<Pending> queue;
+	GLuint written;
+	bool stopping;
+	size_t frameBytes() const
+	{
+		return (size_t)this->Width * this->Height * 4;
+	}
+	size_t queued()
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+		return this->queue.size();
+	}
+	// Hands the finished reads to the writer, oldest first; wait blocks on the fences instead of stopping at the first busy one
+	void collect(bool wait)
+	{
+		for (size_t i = 0; i < this->slots.size(); ++i)
+		{
+			Slot &slot = this->slots[(this->next + i) % this->slots.size()];
+			if (!slot.Fence)
+				continue;
+			GLenum result = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+			while (wait && result == GL_TIMEOUT_EXPIRED)
+				result = glClientWaitSync(slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			if (result == GL_TIMEOUT_EXPIRED)
+				return;
+			glDeleteSync(slot.Fence);
+			slot.Fence = (GLsync)0;
+			Pending pending;
+			pending.Frame = slot.Frame;
+			pending.Pixels.resize(this->frameBytes());
+			GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+			void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, this->frameBytes(), GL_MAP_READ_BIT);
+			if (mapped)
+			{
+				std::memcpy(&pending.Pixels[0], mapped, this->frameBytes());
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+			}
+			GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				this->queue.push_back(std::move(pending));
+			}
+			this->wake.notify_one();
+		}
+	}
+	// Writer thread: encodes and writes queued frames until Finish() and the queue is empty
+	void run()
+	{
+		std::vector<unsigned char> image, encoded;
+		for (;;)
+		{
+			Pending pending;
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->wake.wait(lock, [this]() { return this->stopping || !this->queue.empty(); });
+				if (this->queue.empty())
+					return;
+				pending = std::move(this->queue.front());
+				this->queue.pop_front();
+			}
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			this->flip(pending.Pixels, image);
+			bool ok = true;
+			if (this->Format == CapturePng)
+			{
+				char number[16];
+				std::snprintf(number, sizeof(number), "_%05u.png", pending.Frame + 1);
+				ok = PngWriter::Write((this->path + number).c_str(), this->Width, this->Height, 4, &image[0]);
+			}
+			else if (this->file)
+			{
+				if (this->Format == CaptureY4m)
+				{
+					this->toYuv420(image, encoded);
+					ok = std::fputs("FRAME\n", this->file) >= 0;
+					ok = ok && std::fwrite(&encoded[0], 1, encoded.size(), this->file) == encoded.size();
+				}
+				else
+					ok = std::fwrite(&image[0], 1, image.size(), this->file) == image.size();
+			}
+			if (!ok)
+				std::cout << "ERROR::CAPTURE: cannot write frame " << pending.Frame + 1 << std::endl;
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->WriteMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			this->written++;
+		}
+	}
+	// GL rows start at the bottom, image rows at the top
+	void flip(const std::vector<unsigned char> &pixels, std::vector<unsigned char> &image) const
+	{
+		size_t row = (size_t)this->Width * 4;
+		image.resize(pixels.size());
+		for (GLuint y = 0; y < this->Height; ++y)
+			std::memcpy(&image[y * row], &pixels[(this->Height - 1 - y) * row], row);
+	}
+	// Full range BT.601 Y plane, then U and V planes averaged over 2x2 pixels
+	void toYuv420(const std::vector<unsigned char> &image, std::vector<unsigned char> &yuv) const
+	{
+		GLuint chromaWidth = (this->Width + 1) / 2, chromaHeight = (this->Height + 1) / 2;
+		yuv.resize((size_t)this->Width * this->Height + 2 * (size_t)chromaWidth * chromaHeight);
+		unsigned char *luma = &yuv[0];
+		unsigned char *u = luma + (size_t)this->Width * this->Height;
+		unsigned char *v = u + (size_t)chromaWidth * chromaHeight;
+		for (GLuint y = 0; y < this->Height; ++y)
+			for (GLuint x = 0; x < this->Width; ++x)
+			{
+				const unsigned char *p = &image[((size_t)y * this->Width + x) * 4];
+				luma[(size_t)y * this->Width + x] = clamp(0.299f * p[0] + 0.587f * p[1] + 0.114f * p[2]);
+			}
+		for (GLuint y = 0; y < chromaHeight; ++y)
+			for (GLuint x = 0; x < chromaWidth; ++x)
+			{
+				float r = 0.0f, g = 0.0f, b = 0.0f;
+				for (GLuint dy = 0; dy < 2; ++dy)
+					for (GLuint dx = 0; dx < 2; ++dx)
+					{
+						GLuint sx = std::min(2 * x + dx, this->Width - 1), sy = std::min(2 * y + dy, this->Height - 1);
+						const unsigned char *p = &image[((size_t)sy * this->Width + sx) * 4];
+						r += p[0];
+						g += p[1];
+						b += p[2];
+					}
+				r *= 0.25f;
+				g *= 0.25f;
+				b *= 0.25f;
+				u[(size_t)y * chromaWidth + x] = clamp(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b);
+				v[(size_t)y * chromaWidth + x] = clamp(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b);
+			}
+	}
+	static unsigned char clamp(float value)
+	{
+		return (unsigned char)std::min(255.0f, std::max(0.0f, value + 0.5f));
+	}
+};
+
+#endif
@@ -0,0 +1,87 @@
+#ifndef FRAME_CONSTANTS_H
+#define FRAME_CONSTANTS_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <common/GLState.h>
+
+// FrameConstants owns the uniform buffer behind the std140 block
+//
+//     layout (std140) uniform FrameConstants
+//     {
+//         mat4 projection;
+//         vec4 viewport; // x, y, width, height in pixels
+//         float time;    // seconds since startup
+//     };
+//
+// which stays bound to BindingPoint. Every Shader that declares the
+// block is attached to that binding point when it is linked, so the
+// values set here reach all programs with a single upload per frame.
+class FrameConstants
+{
+public:
+	// Uniform buffer binding point reserved for the block
+	static const GLuint BindingPoint = 0;
+	// Name of the block in GLSL
+	static const GLchar *BlockName()
+	{
+		return "FrameConstants";
+	}
+	// Holds the ID of the uniform buffer
+	GLuint ID;
+	// Values uploaded by Update()
+	glm::mat4 Projection;
+	glm::vec4 Viewport;
+	GLfloat Time;
+	// Constructor (allocates the buffer and binds it to BindingPoint)
+	FrameConstants()
+		: Projection(1.0f), Viewport(0.0f), Time(0.0f)
+	{
+		glGenBuffers(1, &this->ID);
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, this->ID);
+		glBufferData(GL_UNIFORM_BUFFER, sizeof(Block), NULL, GL_DYNAMIC_DRAW);
+		glBindBufferBase(GL_UNIFORM_BUFFER, BindingPoint, this->ID);
+	}
+	FrameConstants(const FrameConstants&) = delete;
+	FrameConstants &operator=(const FrameConstants&) = delete;
+	// Destructor
+	~FrameConstants()
+	{
+		glDeleteBuffers(1, &this->ID);
+		GLState::ForgetBuffer(this->ID);
+	}
+	// Sets an orthographic projection covering the viewport, y pointing down
+	void SetViewport(GLfloat x, GLfloat y, GLfloat width, GLfloat height)
+	{
+		this->Viewport = glm::vec4(x, y, width, height);
+		this->Projection = glm::ortho(0.0f, width, height, 0.0f, -1.0f, 1.0f);
+	}
+	// Sets an orthographic projection covering a world of worldWidth x worldHeight, y pointing down,
+	// drawn into the given viewport whatever its size in pixels
+	void SetView(GLfloat worldWidth, GLfloat worldHeight, glm::vec4 viewport)
+	{
+		this->Viewport = viewport;
+		this->Projection = glm::ortho(0.0f, worldWidth, worldHeight, 0.0f, -1.0f, 1.0f);
+	}
+	// Uploads the current values, call once per frame (or view) before drawing
+	void Update()
+	{
+		Block block;
+		block.Projection = this->Projection;
+		block.Viewport = this->Viewport;
+		block.Time = glm::vec4(this->Time, 0.0f, 0.0f, 0.0f);
+		GLState::BindBuffer(GL_UNIFORM_BUFFER, this->ID);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(Block), &block);
+	}
+private:
+	// std140 image of the GLSL block; the trailing float is padded to a vec4
+	struct Block
+	{
+		glm::mat4 Projection;
+		glm::vec4 Viewport;
+		glm::vec4 Time;
+	};
+};
+
+#endif
@@ -0,0 +1,144 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// Swap interval requested from the window system
+enum SwapMode
+{
+	SwapImmediate = 0, // no vsync, tearing possible
+	SwapVsync = 1,     // wait for vertical blank
+	SwapAdaptive = -1  // vsync, but late frames are shown immediately (needs *_swap_control_tear)
+};
+
+// FramePacer caps the frame rate and measures how evenly frames are
+// presented. Wait() holds the frame until its deadline: it sleeps for
+// most of the remaining time, which releases the CPU, and spins for the
+// last SpinMilliseconds because sleeps overshoot by up to a scheduler
+// tick. Deadlines advance by a fixed period so small overshoots do not
+// accumulate; a frame that is already late starts a new schedule
+// instead of being followed by a burst of short ones. Presented() is
+// called right after the buffer swap and records the present-to-present
+// interval. A frame loop looks like
+//
+//     ...render...; glfwSwapBuffers(window); pacer.Presented();
+//     pacer.Wait(); glfwPollEvents();   // input is read after the wait, not before
+class FramePacer
+{
+public:
+	typedef std::chrono::steady_clock Clock;
+	// Present-to-present statistics over the last HistorySize frames, in milliseconds
+	struct Summary
+	{
+		GLuint Frames;
+		GLfloat Average, Jitter, P99, Max; // Jitter is the standard deviation of the interval
+		GLuint Late;                       // intervals longer than 1.5 target periods since startup
+		Summary() : Frames(0), Average(0.0f), Jitter(0.0f), P99(0.0f), Max(0.0f), Late(0) { }
+	};
+	// Intervals kept for the statistics
+	static const GLuint HistorySize = 240;
+	// Time before the deadline spent spinning instead of sleeping
+	GLfloat SpinMilliseconds;
+	// Total time spent sleeping and spinning in Wait()
+	GLdouble SleptMilliseconds, SpunMilliseconds;
+	// Constructor (targetFps 0 disables the limiter, Presented() still measures)
+	explicit FramePacer(GLfloat targetFps = 0.0f)
+		: SpinMilliseconds(2.0f), SleptMilliseconds(0.0), SpunMilliseconds(0.0), frames(0), late(0), started(false)
+	{
+		this->SetTargetFps(targetFps);
+	}
+	void SetTargetFps(GLfloat targetFps)
+	{
+		this->targetFps = targetFps;
+		this->period = targetFps > 0.0f ? std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps)) : Clock::duration::zero();
+		this->deadline = Clock::now() + this->period;
+	}
+	GLfloat TargetFps() const
+	{
+		return this->targetFps;
+	}
+	// Blocks until the frame's deadline, returns at once without a target frame rate
+	void Wait()
+	{
+		if (this->targetFps <= 0.0f)
+			return;
+		Clock::time_point now = Clock::now();
+		if (now >= this->deadline)
+		{
+			// late already: start a new schedule from now rather than catching up
+			this->deadline = now + this->period;
+			return;
+		}
+		Clock::duration spin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(this->SpinMilliseconds));
+		if (this->deadline - now > spin)
+		{
+			std::this_thread::sleep_for(this->deadline - now - spin);
+			Clock::time_point woke = Clock::now();
+			this->SleptMilliseconds += std::chrono::duration<double, std::milli>(woke - now).count();
+			now = woke;
+		}
+		Clock::time_point spinStart = now;
+		while (now < this->deadline)
+		{
+			std::this_thread::yield();
+			now = Clock::now();
+		}
+		this->SpunMilliseconds += std::chrono::duration<double, std::milli>(now - spinStart).count();
+		this->deadline += this->period;
+		if (this->deadline <= now)
+			this->deadline = now + this->period;
+	}
+	// Records a present, call right after swapping buffers
+	void Presented()
+	{
+		Clock::time_point now = Clock::now();
+		if (this->started)
+		{
+			GLfloat interval = (GLfloat)std::chrono::duration<double, std::milli>(now - this->lastPresent).count();
+			if (this->intervals.size() < HistorySize)
+				this->intervals.push_back(interval);
+			else
+				this->intervals[this->frames % HistorySize] = interval;
+			this->frames++;
+			if (this->targetFps > 0.0f && interval > 1.5f * 1000.0f / this->targetFps)
+				this->late++;
+		}
+		this->lastPresent = now;
+		this->started = true;
+	}
+	Summary Stats() const
+	{
+		Summary summary;
+		if (this->intervals.empty())
+			return summary;
+		std::vector<GLfloat> sorted(this->intervals);
+		std::sort(sorted.begin(), sorted.end());
+		double sum = 0.0, squares = 0.0;
+		for (size_t i = 0; i < sorted.size(); ++i)
+		{
+			sum += sorted[i];
+			squares += sorted[i] * sorted[i];
+		}
+		double mean = sum / sorted.size();
+		summary.Frames = this->frames;
+		summary.Average = (GLfloat)mean;
+		summary.Jitter = (GLfloat)std::sqrt(std::max(0.0, squares / sorted.size() - mean * mean));
+		summary.P99 = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+		summary.Max = sorted.back();
+		summary.Late = this->late;
+		return summary;
+	}
+private:
+	GLfloat targetFps;
+	Clock::duration period;
+	Clock::time_point deadline, lastPresent;
+	std::vector<GLfloat> intervals;
+	GLuint frames, late;
+	bool started;
+};
+
+#endif
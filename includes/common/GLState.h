@@ -0,0 +1,280 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include <map>
+
+#include <glm/glm.hpp>
+
+// GLState shadows the OpenGL binding state that the renderer touches
+// on every draw (program, active texture unit, texture bindings, VAO,
+// buffer and framebuffer bindings, viewport, blend and depth state) and skips
+// calls that would not change anything. Every bind in the engine has
+// to go through it, otherwise the shadow copy goes stale; call
+// Invalidate() after handing the context to code that binds on its
+// own, and the matching Forget*() when deleting an object. Redundant
+// (hit) and issued (miss) calls are counted per frame.
+// All functions are static.
+class GLState
+{
+public:
+	// Hit/miss counters of a frame
+	struct Counters
+	{
+		GLuint Hits, Misses;
+		Counters() : Hits(0), Misses(0) { }
+	};
+	// Number of texture units tracked
+	static const GLuint MaxTextureUnits = 16;
+	// Binds program unless it is already in use
+	static void UseProgram(GLuint program)
+	{
+		State &state = current();
+		if (record(state.Program == program))
+			return;
+		glUseProgram(program);
+		state.Program = program;
+	}
+	// Selects the active texture unit (GL_TEXTURE0 + n)
+	static void ActiveTexture(GLenum unit)
+	{
+		State &state = current();
+		if (record(state.ActiveUnit == unit - GL_TEXTURE0))
+			return;
+		glActiveTexture(unit);
+		state.ActiveUnit = unit - GL_TEXTURE0;
+	}
+	// Binds texture to target on the active texture unit
+	static void BindTexture(GLenum target, GLuint texture)
+	{
+		State &state = current();
+		int slot = targetSlot(target);
+		if (slot < 0 || state.ActiveUnit >= MaxTextureUnits)
+		{
+			record(false);
+			glBindTexture(target, texture);
+			return;
+		}
+		GLuint &bound = state.Textures[state.ActiveUnit][slot];
+		if (record(bound == texture))
+			return;
+		glBindTexture(target, texture);
+		bound = texture;
+	}
+	// Binds texture to target on the given texture unit
+	static void BindTexture(GLuint unit, GLenum target, GLuint texture)
+	{
+		State &state = current();
+		int slot = targetSlot(target);
+		if (slot >= 0 && unit < MaxTextureUnits && state.Textures[unit][slot] == texture)
+		{
+			record(true);
+			return;
+		}
+		ActiveTexture(GL_TEXTURE0 + unit);
+		BindTexture(target, texture);
+	}
+	// Binds a vertex array object
+	static void BindVertexArray(GLuint vao)
+	{
+		State &state = current();
+		if (record(state.VertexArray == vao))
+			return;
+		glBindVertexArray(vao);
+		state.VertexArray = vao;
+	}
+	// Binds a buffer object. GL_ELEMENT_ARRAY_BUFFER is part of the VAO state and is
+	// always forwarded.
+	static void BindBuffer(GLenum target, GLuint buffer)
+	{
+		State &state = current();
+		if (target == GL_ELEMENT_ARRAY_BUFFER)
+		{
+			record(false);
+			glBindBuffer(target, buffer);
+			return;
+		}
+		std::map<GLenum, GLuint>::iterator bound = state.Buffers.find(target);
+		if (record(bound != state.Buffers.end() && bound->second == buffer))
+			return;
+		glBindBuffer(target, buffer);
+		state.Buffers[target] = buffer;
+	}
+	// Binds a framebuffer to GL_DRAW_FRAMEBUFFER, GL_READ_FRAMEBUFFER or both (GL_FRAMEBUFFER)
+	static void BindFramebuffer(GLenum target, GLuint framebuffer)
+	{
+		State &state = current();
+		bool draw = target != GL_READ_FRAMEBUFFER, read = target != GL_DRAW_FRAMEBUFFER;
+		if (record((!draw || state.DrawFramebuffer == framebuffer) && (!read || state.ReadFramebuffer == framebuffer)))
+			return;
+		glBindFramebuffer(target, framebuffer);
+		if (draw)
+			state.DrawFramebuffer = framebuffer;
+		if (read)
+			state.ReadFramebuffer = framebuffer;
+	}
+	// Sets the viewport
+	static void Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		State &state = current();
+		glm::ivec4 viewport(x, y, width, height);
+		if (record(state.Viewport == viewport))
+			return;
+		glViewport(x, y, width, height);
+		state.Viewport = viewport;
+	}
+	// Last viewport set through Viewport(): x, y, width, height
+	static glm::ivec4 GetViewport()
+	{
+		return current().Viewport;
+	}
+	// Enables or disables a capability such as GL_BLEND or GL_DEPTH_TEST
+	static void Enable(GLenum capability, GLboolean enabled = GL_TRUE)
+	{
+		State &state = current();
+		std::map<GLenum, GLboolean>::iterator known = state.Capabilities.find(capability);
+		if (record(known != state.Capabilities.end() && known->second == enabled))
+			return;
+		if (enabled)
+			glEnable(capability);
+		else
+			glDisable(capability);
+		state.Capabilities[capability] = enabled;
+	}
+	static void Disable(GLenum capability)
+	{
+		Enable(capability, GL_FALSE);
+	}
+	// Enables or disables depth writes
+	static void DepthMask(GLboolean write)
+	{
+		State &state = current();
+		if (record(state.DepthWrite == (GLint)write))
+			return;
+		glDepthMask(write);
+		state.DepthWrite = write;
+	}
+	// Sets the depth comparison
+	static void DepthFunc(GLenum func)
+	{
+		State &state = current();
+		if (record(state.DepthFunc == func))
+			return;
+		glDepthFunc(func);
+		state.DepthFunc = func;
+	}
+	// Sets the blend function
+	static void BlendFunc(GLenum source, GLenum destination)
+	{
+		State &state = current();
+		if (record(state.BlendSource == source && state.BlendDestination == destination))
+			return;
+		glBlendFunc(source, destination);
+		state.BlendSource = source;
+		state.BlendDestination = destination;
+	}
+	// Deleting an object unbinds it and frees its name for the next glGen*, so a shadowed
+	// binding of it has to go too: call these with every glDelete* of the kind.
+	static void ForgetTexture(GLuint texture)
+	{
+		State &state = current();
+		for (GLuint i = 0; i < MaxTextureUnits; ++i)
+			for (int slot = 0; slot < 2; ++slot)
+				if (state.Textures[i][slot] == texture)
+					state.Textures[i][slot] = 0;
+	}
+	static void ForgetBuffer(GLuint buffer)
+	{
+		State &state = current();
+		for (std::map<GLenum, GLuint>::iterator it = state.Buffers.begin(); it != state.Buffers.end(); ++it)
+			if (it->second == buffer)
+				it->second = 0;
+	}
+	static void ForgetFramebuffer(GLuint framebuffer)
+	{
+		State &state = current();
+		if (state.DrawFramebuffer == framebuffer)
+			state.DrawFramebuffer = 0;
+		if (state.ReadFramebuffer == framebuffer)
+			state.ReadFramebuffer = 0;
+	}
+	static void ForgetVertexArray(GLuint vao)
+	{
+		State &state = current();
+		if (state.VertexArray == vao)
+			state.VertexArray = 0;
+	}
+	// Forgets all shadowed state, the next call of every kind reaches OpenGL
+	static void Invalidate()
+	{
+		State &state = current();
+		State fresh;
+		fresh.Frame = state.Frame;
+		fresh.Last = state.Last;
+		fresh.Total = state.Total;
+		state = fresh;
+	}
+	// Closes the frame's counters, see LastFrame()
+	static void EndFrame()
+	{
+		State &state = current();
+		state.Last = state.Frame;
+		state.Total.Hits += state.Frame.Hits;
+		state.Total.Misses += state.Frame.Misses;
+		state.Frame = Counters();
+	}
+	// Counters of the last completed frame and since startup
+	static Counters LastFrame()
+	{
+		return current().Last;
+	}
+	static Counters Total()
+	{
+		return current().Total;
+	}
+private:
+	struct State
+	{
+		GLuint Program;
+		GLuint ActiveUnit;
+		GLuint Textures[MaxTextureUnits][2]; // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY
+		GLuint VertexArray;
+		std::map<GLenum, GLuint> Buffers;
+		GLuint DrawFramebuffer, ReadFramebuffer;
+		glm::ivec4 Viewport;
+		std::map<GLenum, GLboolean> Capabilities;
+		GLenum BlendSource, BlendDestination;
+		GLint DepthWrite;
+		GLenum DepthFunc;
+		Counters Frame, Last, Total;
+		// Unknown values that never match a real binding, so the first call always goes through
+		State() : Program(~0u), ActiveUnit(~0u), VertexArray(~0u), DrawFramebuffer(~0u), ReadFramebuffer(~0u), Viewport(-1), BlendSource(GL_NONE), BlendDestination(GL_NONE), DepthWrite(-1), DepthFunc(GL_NONE)
+		{
+			for (GLuint i = 0; i < MaxTextureUnits; ++i)
+				this->Textures[i][0] = this->Textures[i][1] = ~0u;
+		}
+	};
+	GLState() { }
+	static State &current()
+	{
+		static State state;
+		return state;
+	}
+	static bool record(bool hit)
+	{
+		if (hit)
+			current().Frame.Hits++;
+		else
+			current().Frame.Misses++;
+		return hit;
+	}
+	static int targetSlot(GLenum target)
+	{
+		if (target == GL_TEXTURE_2D)
+			return 0;
+		if (target == GL_TEXTURE_2D_ARRAY)
+			return 1;
+		return -1;
+	}
+};
+
+#endif
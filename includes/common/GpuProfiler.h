@@ -0,0 +1,246 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// GpuProfiler measures the GPU time of named scopes with timestamp
+// queries (glQueryCounter), so scopes may nest. Each frame writes its
+// queries into one slot of a ring of FramesInFlight slots; a slot is
+// read back when the ring comes around to it again, several frames
+// later, and only if the GPU has finished it, so reading never stalls.
+// Scopes with the same name add up to one sample per frame, the last
+// HistorySize samples of every name give the rolling statistics.
+// Usage:
+//
+//     { GpuScope scope("sprites"); ...draw... }
+//     GpuProfiler::EndFrame();   // once per frame, after the last scope
+//
+// All functions are static.
+class GpuProfiler
+{
+public:
+	// Frames a query may stay in flight before its results are read
+	static const GLuint FramesInFlight = 5;
+	// Samples kept per scope for the statistics
+	static const GLuint HistorySize = 128;
+	// Rolling statistics of a scope, in milliseconds
+	struct Summary
+	{
+		GLuint Samples;  // frames measured since startup
+		GLfloat Last, Average, Median, P95, Max;
+		Summary() : Samples(0), Last(0.0f), Average(0.0f), Median(0.0f), P95(0.0f), Max(0.0f) { }
+	};
+	// Turns profiling on or off, scopes cost nothing while off
+	static void SetEnabled(GLboolean enabled)
+	{
+		current().Enabled = enabled;
+	}
+	// Opens a scope, must be matched by End()
+	static void Begin(const std::string &name)
+	{
+		State &state = current();
+		if (!state.Enabled)
+			return;
+		Frame &frame = state.Frames[state.Head];
+		Range range;
+		range.Scope = scopeIndex(name);
+		range.Begin = frame.timestamp();
+		range.End = 0;
+		state.Open.push_back(frame.Ranges.size());
+		frame.Ranges.push_back(range);
+	}
+	// Closes the innermost open scope
+	static void End()
+	{
+		State &state = current();
+		if (!state.Enabled || state.Open.empty())
+			return;
+		Frame &frame = state.Frames[state.Head];
+		frame.Ranges[state.Open.back()].End = frame.timestamp();
+		state.Open.pop_back();
+	}
+	// Closes the frame and reads back the finished frames, oldest first
+	static void EndFrame()
+	{
+		State &state = current();
+		if (!state.Enabled)
+			return;
+		state.Open.clear();
+		state.Frames[state.Head].Pending = !state.Frames[state.Head].Ranges.empty();
+		state.Head = (state.Head + 1) % FramesInFlight;
+		for (GLuint i = 0; i < FramesInFlight; ++i)
+		{
+			Frame &frame = state.Frames[(state.Head + i) % FramesInFlight];
+			if (frame.Pending && !resolve(frame))
+				break;
+		}
+		// the GPU is more than FramesInFlight frames behind: the slot is reused, its results are lost
+		Frame &next = state.Frames[state.Head];
+		if (next.Pending)
+			state.Dropped++;
+		next.Pending = false;
+		next.Used = 0;
+		next.Ranges.clear();
+	}
+	// Statistics of the named scope, all zero if it was never measured
+	static Summary Get(const std::string &name)
+	{
+		State &state = current();
+		std::map<std::string, GLuint>::const_iterator it = state.Names.find(name);
+		if (it == state.Names.end())
+			return Summary();
+		return summarize(state.Scopes[it->second]);
+	}
+	// Names of all scopes seen so far
+	static std::vector<std::string> Names()
+	{
+		State &state = current();
+		std::vector<std::string> names;
+		for (size_t i = 0; i < state.Scopes.size(); ++i)
+			names.push_back(state.Scopes[i].Name);
+		return names;
+	}
+	// Frames whose results were lost because the GPU had not finished them in time
+	static GLuint Dropped()
+	{
+		return current().Dropped;
+	}
+private:
+	struct Range
+	{
+		GLuint Scope;
+		GLuint Begin, End; // indices into the frame's queries
+	};
+	struct Frame
+	{
+		std::vector<GLuint> Queries;
+		GLuint Used;
+		std::vector<Range> Ranges;
+		bool Pending;
+		Frame() : Used(0), Pending(false) { }
+		// Records a timestamp into the next free query of the frame and returns its index
+		GLuint timestamp()
+		{
+			if (this->Used == this->Queries.size())
+			{
+				GLuint query;
+				glGenQueries(1, &query);
+				this->Queries.push_back(query);
+			}
+			glQueryCounter(this->Queries[this->Used], GL_TIMESTAMP);
+			return this->Used++;
+		}
+	};
+	struct Scope
+	{
+		std::string Name;
+		std::vector<GLfloat> History; // ring of per-frame milliseconds
+		GLuint Samples;
+		GLfloat FrameSum;             // total of the frame being resolved
+		Scope() : Samples(0), FrameSum(0.0f) { }
+	};
+	struct State
+	{
+		GLboolean Enabled;
+		Frame Frames[FramesInFlight];
+		GLuint Head;
+		std::vector<size_t> Open;
+		std::map<std::string, GLuint> Names;
+		std::vector<Scope> Scopes;
+		GLuint Dropped;
+		State() : Enabled(GL_TRUE), Head(0), Dropped(0) { }
+	};
+	GpuProfiler() { }
+	static State &current()
+	{
+		static State state;
+		return state;
+	}
+	static GLuint scopeIndex(const std::string &name)
+	{
+		State &state = current();
+		std::map<std::string, GLuint>::const_iterator it = state.Names.find(name);
+		if (it != state.Names.end())
+			return it->second;
+		Scope scope;
+		scope.Name = name;
+		state.Scopes.push_back(scope);
+		return state.Names[name] = (GLuint)state.Scopes.size() - 1;
+	}
+	// Turns the frame's timestamps into samples; false if the GPU has not reached its end yet
+	static bool resolve(Frame &frame)
+	{
+		GLint available = 0;
+		glGetQueryObjectiv(frame.Queries[frame.Used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			return false;
+		std::vector<GLuint64> times(frame.Used);
+		for (GLuint i = 0; i < frame.Used; ++i)
+			glGetQueryObjectui64v(frame.Queries[i], GL_QUERY_RESULT, &times[i]);
+		State &state = current();
+		std::vector<GLuint> touched;
+		for (size_t i = 0; i < frame.Ranges.size(); ++i)
+		{
+			const Range &range = frame.Ranges[i];
+			if (range.End == 0)
+				continue; // never closed
+			Scope &scope = state.Scopes[range.Scope];
+			if (std::find(touched.begin(), touched.end(), range.Scope) == touched.end())
+			{
+				touched.push_back(range.Scope);
+				scope.FrameSum = 0.0f;
+			}
+			scope.FrameSum += (times[range.End] - times[range.Begin]) / 1.0e6f;
+		}
+		for (size_t i = 0; i < touched.size(); ++i)
+		{
+			Scope &scope = state.Scopes[touched[i]];
+			if (scope.History.size() < HistorySize)
+				scope.History.push_back(scope.FrameSum);
+			else
+				scope.History[scope.Samples % HistorySize] = scope.FrameSum;
+			scope.Samples++;
+		}
+		frame.Pending = false;
+		return true;
+	}
+	static Summary summarize(const Scope &scope)
+	{
+		Summary summary;
+		if (scope.History.empty())
+			return summary;
+		std::vector<GLfloat> sorted(scope.History);
+		std::sort(sorted.begin(), sorted.end());
+		GLfloat sum = 0.0f;
+		for (size_t i = 0; i < sorted.size(); ++i)
+			sum += sorted[i];
+		summary.Samples = scope.Samples;
+		summary.Last = scope.History[(scope.Samples - 1) % HistorySize];
+		summary.Average = sum / sorted.size();
+		summary.Median = sorted[sorted.size() / 2];
+		summary.P95 = sorted[std::min(sorted.size() - 1, sorted.size() * 95 / 100)];
+		summary.Max = sorted.back();
+		return summary;
+	}
+};
+
+// Times the enclosing block as a GpuProfiler scope
+class GpuScope
+{
+public:
+	explicit GpuScope(const std::string &name)
+	{
+		GpuProfiler::Begin(name);
+	}
+	~GpuScope()
+	{
+		GpuProfiler::End();
+	}
+	GpuScope(const GpuScope&) = delete;
+	GpuScope &operator=(const GpuScope&) = delete;
+};
+
+#endif
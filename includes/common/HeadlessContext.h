@@ -0,0 +1,100 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <iostream>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <common/RenderTarget.h>
+
+// HeadlessContext creates an OpenGL 3.3 core context without a window
+// or display server, through EGL on the Mesa surfaceless platform
+// (llvmpipe when there is no GPU), and loads the GL functions with
+// glad. With no window there is no default framebuffer either: the
+// frame is presented into Screen(), an offscreen RenderTarget of the
+// requested size, which ReadPixels() copies back for snapshots.
+class HeadlessContext
+{
+public:
+	HeadlessContext() : display(EGL_NO_DISPLAY), context(EGL_NO_CONTEXT), screen(nullptr) { }
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext &operator=(const HeadlessContext&) = delete;
+	// Destructor
+	~HeadlessContext()
+	{
+		delete this->screen;
+		if (this->display != EGL_NO_DISPLAY)
+		{
+			eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (this->context != EGL_NO_CONTEXT)
+				eglDestroyContext(this->display, this->context);
+			eglTerminate(this->display);
+		}
+	}
+	// Creates the context, makes it current and allocates a width x height screen; false on failure
+	bool Create(GLuint width, GLuint height)
+	{
+		PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay)
+			this->display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+		if (this->display == EGL_NO_DISPLAY)
+			this->display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+		EGLint major, minor;
+		if (this->display == EGL_NO_DISPLAY || !eglInitialize(this->display, &major, &minor))
+			return fail("no EGL display");
+		if (!eglBindAPI(EGL_OPENGL_API))
+			return fail("EGL cannot create desktop OpenGL contexts");
+		const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_SURFACE_TYPE, 0, EGL_NONE };
+		EGLConfig config;
+		EGLint configs = 0;
+		if (!eglChooseConfig(this->display, configAttributes, &config, 1, &configs) || configs == 0)
+			config = EGL_NO_CONFIG_KHR; // no surface will be created, EGL_KHR_no_config_context is enough
+		const EGLint contextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE };
+		this->context = eglCreateContext(this->display, config, EGL_NO_CONTEXT, contextAttributes);
+		if (this->context == EGL_NO_CONTEXT)
+			return fail("cannot create an OpenGL 3.3 core context");
+		// surfaceless: EGL_KHR_surfaceless_context allows a current context without any surface
+		if (!eglMakeCurrent(this->display, EGL_NO_SURFACE, EGL_NO_SURFACE, this->context))
+			return fail("cannot make the context current without a surface");
+		if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+			return fail("cannot load the OpenGL functions");
+		std::cout << "headless: " << glGetString(GL_RENDERER) << ", OpenGL " << glGetString(GL_VERSION) << std::endl;
+		this->screen = new RenderTarget();
+		this->screen->Generate(width, height);
+		return true;
+	}
+	// Offscreen framebuffer standing in for the window
+	const RenderTarget &Screen() const
+	{
+		return *this->screen;
+	}
+	// Copies the screen into pixels as RGBA rows, top row first
+	void ReadPixels(std::vector<unsigned char> &pixels) const
+	{
+		GLuint width = this->screen->Width, height = this->screen->Height;
+		std::vector<unsigned char> flipped(width * height * 4);
+		GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, this->screen->ID);
+		GLState::BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &flipped[0]);
+		pixels.resize(flipped.size());
+		size_t row = width * 4;
+		for (GLuint y = 0; y < height; ++y)
+			std::copy(flipped.begin() + (height - 1 - y) * row, flipped.begin() + (height - y) * row, pixels.begin() + y * row);
+	}
+private:
+	EGLDisplay display;
+	EGLContext context;
+	RenderTarget *screen;
+	static bool fail(const char *reason)
+	{
+		std::cout << "ERROR::HEADLESS: " << reason << " (EGL error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+		return false;
+	}
+};
+
+#endif
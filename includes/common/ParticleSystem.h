@@ -0,0 +1,311 @@
+#ifndef PARTICLE_SYSTEM_H
+#define PARTICLE_SYSTEM_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <deque>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <common/GLState.h>
+#include <common/GpuProfiler.h>
+#include <common/Shader.h>
+
+// A particle as stored on the GPU, 32 bytes (particle_update.vs/.comp, particle.vs)
+struct Particle
+{
+	glm::vec4 PositionVelocity; // world units and units per second
+	glm::vec3 LifeSize;         // seconds left (dead at 0), lifetime, size
+	GLuint Color;               // RGBA8, red in the lowest byte
+};
+
+// Where and how ParticleSystem::Emit spawns particles; every range is sampled uniformly
+struct ParticleEmitter
+{
+	glm::vec2 Position;
+	GLfloat Radius;                // particles start anywhere within it
+	GLfloat Angle, Spread;         // direction of travel in radians (y points down) and deviation either way
+	GLfloat MinSpeed, MaxSpeed;
+	GLfloat MinLife, MaxLife;      // seconds
+	GLfloat MinSize, MaxSize;
+	glm::vec4 ColorA, ColorB;      // each particle takes a random mix of the two
+	ParticleEmitter()
+		: Position(0.0f), Radius(0.0f), Angle(0.0f), Spread(glm::pi<GLfloat>()), MinSpeed(0.0f), MaxSpeed(100.0f),
+		  MinLife(1.0f), MaxLife(1.0f), MinSize(4.0f), MaxSize(4.0f), ColorA(1.0f), ColorB(1.0f) { }
+};
+
+// ParticleSystem simulates and draws particles entirely on the GPU.
+// Particles live in a ring of Capacity slots; Emit() generates them on
+// the CPU and Update() uploads them at the ring cursor, so the oldest
+// particles are replaced once the ring is full. Emissions are tracked
+// as batches expiring with their longest lifetime, which bounds the
+// window of slots that can hold live particles: only that window is
+// simulated and drawn. Simulation runs with transform feedback between
+// two buffers (GL 3.3), or in place with a compute shader when one is
+// given and GL 4.3 is available. Drawing is one instanced quad per
+// particle, additively blended. Programs still compiling skip the work.
+class ParticleSystem
+{
+public:
+	// Ring size in particles
+	const GLuint Capacity;
+	// Applied to every particle, in units per second squared and fraction of speed lost per second
+	glm::vec2 Gravity;
+	GLfloat Drag;
+	// Particles generated since creation, and those lost because Capacity was exceeded
+	GLuint Emitted, Overwritten;
+	// Load of the last frame and its GPU cost (rolling averages of the "particles_*" scopes)
+	struct Stats
+	{
+		GLuint Live;     // particles of unexpired emissions, an upper bound of the visible ones
+		GLuint Window;   // slots simulated and drawn
+		GLfloat SimulateMilliseconds, DrawMilliseconds;
+	};
+	// Constructor (update is particle_update.vs linked for transform feedback, draw is particle.vs/.fs;
+	// compute is particle_update.comp and replaces update when set and GL 4.3 is available)
+	ParticleSystem(GLuint capacity, Shader update, Shader draw, Shader compute = Shader())
+		: Capacity(capacity), Gravity(0.0f), Drag(0.0f), Emitted(0), Overwritten(0),
+		  update(update), draw(draw), compute(compute), useCompute(compute.ID != 0 && GLAD_GL_VERSION_4_3),
+		  current(0), cursor(0), live(0), clock(0.0), random(1)
+	{
+		glGenBuffers(2, this->buffers);
+		for (int i = 0; i < (this->useCompute ? 1 : 2); ++i)
+		{
+			GLState::BindBuffer(GL_ARRAY_BUFFER, this->buffers[i]);
+			glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)capacity * sizeof(Particle), NULL, GL_DYNAMIC_COPY);
+		}
+		GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+		glGenVertexArrays(1, &this->simulateVAO);
+		glGenVertexArrays(1, &this->drawVAO);
+	}
+	ParticleSystem(const ParticleSystem&) = delete;
+	ParticleSystem &operator=(const ParticleSystem&) = delete;
+	// Destructor
+	~ParticleSystem()
+	{
+		glDeleteBuffers(2, this->buffers);
+		GLState::ForgetBuffer(this->buffers[0]);
+		GLState::ForgetBuffer(this->buffers[1]);
+		glDeleteVertexArrays(1, &this->simulateVAO);
+		GLState::ForgetVertexArray(this->simulateVAO);
+		glDeleteVertexArrays(1, &this->drawVAO);
+		GLState::ForgetVertexArray(this->drawVAO);
+	}
+	// True when the simulation runs in a compute shader
+	bool UsesCompute() const
+	{
+		return this->useCompute;
+	}
+	// Generates count particles, they enter the simulation at the next Update()
+	void Emit(const ParticleEmitter &emitter, GLuint count)
+	{
+		// nothing reaches the GPU while the programs compile, at most one ring of particles waits
+		count = std::min<GLuint>(count, this->Capacity - (GLuint)std::min<size_t>(this->pending.size(), this->Capacity));
+		if (count == 0)
+			return;
+		Batch batch;
+		batch.Count = count;
+		batch.Expires = emitter.MaxLife;
+		this->pendingBatches.push_back(batch);
+		size_t start = this->pending.size();
+		this->pending.resize(start + count);
+		for (GLuint i = 0; i < count; ++i)
+		{
+			Particle &particle = this->pending[start + i];
+			GLfloat angle = emitter.Angle + (2.0f * this->uniform() - 1.0f) * emitter.Spread;
+			GLfloat speed = glm::mix(emitter.MinSpeed, emitter.MaxSpeed, this->uniform());
+			// square root: uniform over the disc's area, not crowded in its center
+			GLfloat offset = emitter.Radius * std::sqrt(this->uniform()), offsetAngle = glm::two_pi<GLfloat>() * this->uniform();
+			particle.PositionVelocity = glm::vec4(emitter.Position.x + offset * std::cos(offsetAngle), emitter.Position.y + offset * std::sin(offsetAngle),
+			                                      speed * std::cos(angle), speed * std::sin(angle));
+			GLfloat life = glm::mix(emitter.MinLife, emitter.MaxLife, this->uniform());
+			particle.LifeSize = glm::vec3(life, life, glm::mix(emitter.MinSize, emitter.MaxSize, this->uniform()));
+			particle.Color = pack(glm::mix(emitter.ColorA, emitter.ColorB, this->uniform()));
+		}
+		this->Emitted += count;
+	}
+	// Uploads the new particles and advances all by deltaTime seconds
+	void Update(GLfloat deltaTime)
+	{
+		Shader &program = this->useCompute ? this->compute : this->update;
+		if (!program.Ready())
+			return;
+		this->upload();
+		this->clock += deltaTime;
+		while (!this->batches.empty() && this->batches.front().Expires <= this->clock)
+		{
+			this->live -= this->batches.front().Count;
+			this->batches.pop_front();
+		}
+		GLuint ranges[2][2];
+		int count = this->window(ranges);
+		if (count == 0)
+			return;
+		GpuScope scope("particles_simulate");
+		program.Use();
+		program.SetFloat(program.GetUniform("deltaTime"), deltaTime);
+		program.SetVector2f(program.GetUniform("gravity"), this->Gravity.x, this->Gravity.y);
+		program.SetFloat(program.GetUniform("drag"), this->Drag);
+		if (this->useCompute)
+		{
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, this->buffers[0]);
+			for (int i = 0; i < count; ++i)
+			{
+				program.SetInteger(program.GetUniform("first"), ranges[i][0]);
+				program.SetInteger(program.GetUniform("count"), ranges[i][1]);
+				glDispatchCompute((ranges[i][1] + 255) / 256, 1, 1);
+			}
+			// drawn as vertex attributes, and the next upload() writes over shader written slots
+			glMemoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+			return;
+		}
+		// transform feedback from the current buffer into the other one, slot for slot
+		GLuint target = this->buffers[1 - this->current];
+		GLState::BindVertexArray(this->simulateVAO);
+		GLState::Enable(GL_RASTERIZER_DISCARD);
+		for (int i = 0; i < count; ++i)
+		{
+			this->pointAttributes(this->buffers[this->current], ranges[i][0], false);
+			glBindBufferRange(GL_TRANSFORM_FEEDBACK_BUFFER, 0, target, (GLintptr)ranges[i][0] * sizeof(Particle), (GLsizeiptr)ranges[i][1] * sizeof(Particle));
+			glBeginTransformFeedback(GL_POINTS);
+			glDrawArrays(GL_POINTS, 0, ranges[i][1]);
+			glEndTransformFeedback();
+		}
+		GLState::Disable(GL_RASTERIZER_DISCARD);
+		glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+		this->current = 1 - this->current;
+	}
+	// Draws the live particles into the bound framebuffer with additive blending
+	void Draw()
+	{
+		GLuint ranges[2][2];
+		int count = this->window(ranges);
+		if (count == 0 || !this->draw.Ready())
+			return;
+		GpuScope scope("particles_draw");
+		this->draw.Use();
+		GLState::BindVertexArray(this->drawVAO);
+		GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE);
+		for (int i = 0; i < count; ++i)
+		{
+			this->pointAttributes(this->buffers[this->current], ranges[i][0], true);
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, ranges[i][1]);
+		}
+		GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	}
+	Stats GetStats() const
+	{
+		Stats stats;
+		GLuint ranges[2][2];
+		int count = this->window(ranges);
+		stats.Live = this->live;
+		stats.Window = 0;
+		for (int i = 0; i < count; ++i)
+			stats.Window += ranges[i][1];
+		stats.SimulateMilliseconds = GpuProfiler::Get("particles_simulate").Average;
+		stats.DrawMilliseconds = GpuProfiler::Get("particles_draw").Average;
+		return stats;
+	}
+private:
+	// Particles of one Emit() call, First and Expires are set when uploaded
+	struct Batch
+	{
+		GLuint First, Count;
+		GLdouble Expires;
+	};
+	Shader update, draw, compute;
+	bool useCompute;
+	GLuint buffers[2];
+	GLuint current; // buffer holding the latest state
+	GLuint simulateVAO, drawVAO;
+	GLuint cursor;  // next slot written
+	std::deque<Batch> batches;
+	GLuint live;
+	GLdouble clock; // simulated seconds
+	std::vector<Particle> pending;
+	std::vector<Batch> pendingBatches;
+	std::mt19937 random;
+	GLfloat uniform()
+	{
+		return (this->random() >> 8) * (1.0f / 16777216.0f);
+	}
+	static GLuint pack(const glm::vec4 &color)
+	{
+		glm::vec4 bytes = glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f;
+		return (GLuint)bytes.r | ((GLuint)bytes.g << 8) | ((GLuint)bytes.b << 16) | ((GLuint)bytes.a << 24);
+	}
+	// Writes the pending particles at the cursor, wrapping around the ring
+	void upload()
+	{
+		if (this->pending.empty())
+			return;
+		GLState::BindBuffer(GL_ARRAY_BUFFER, this->buffers[this->current]);
+		size_t next = 0;
+		for (size_t b = 0; b < this->pendingBatches.size(); ++b)
+		{
+			Batch batch = this->pendingBatches[b];
+			batch.First = this->cursor;
+			batch.Expires += this->clock;
+			for (GLuint written = 0; written < batch.Count; )
+			{
+				GLuint run = std::min(batch.Count - written, this->Capacity - this->cursor);
+				glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)this->cursor * sizeof(Particle), run * sizeof(Particle), &this->pending[next + written]);
+				written += run;
+				this->cursor = (this->cursor + run) % this->Capacity;
+			}
+			next += batch.Count;
+			this->batches.push_back(batch);
+			this->live += batch.Count;
+			// the oldest emissions were overwritten
+			while (this->live > this->Capacity)
+			{
+				this->live -= this->batches.front().Count;
+				this->Overwritten += this->batches.front().Count;
+				this->batches.pop_front();
+			}
+		}
+		this->pending.clear();
+		this->pendingBatches.clear();
+	}
+	// Slots from the oldest live batch to the cursor as up to two (first, count) ranges
+	int window(GLuint ranges[2][2]) const
+	{
+		if (this->batches.empty())
+			return 0;
+		GLuint first = this->batches.front().First;
+		GLuint count = (this->cursor + this->Capacity - first) % this->Capacity;
+		if (count == 0)
+			count = this->Capacity;
+		ranges[0][0] = first;
+		ranges[0][1] = std::min(count, this->Capacity - first);
+		if (ranges[0][1] == count)
+			return 1;
+		ranges[1][0] = 0;
+		ranges[1][1] = count - ranges[0][1];
+		return 2;
+	}
+	// Points the bound vertex array at the particles from slot first, per vertex to simulate, per instance to draw
+	void pointAttributes(GLuint buffer, GLuint first, bool instanced)
+	{
+		GLState::BindBuffer(GL_ARRAY_BUFFER, buffer);
+		const GLchar *base = (const GLchar*)((size_t)first * sizeof(Particle));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Particle), base);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Particle), base + offsetof(Particle, LifeSize));
+		glEnableVertexAttribArray(2);
+		if (instanced)
+			glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Particle), base + offsetof(Particle, Color));
+		else
+			glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(Particle), base + offsetof(Particle, Color));
+		GLuint divisor = instanced ? 1 : 0;
+		for (GLuint i = 0; i < 3; ++i)
+			glVertexAttribDivisor(i, divisor);
+	}
+};
+
+#endif
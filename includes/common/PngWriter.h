@@ -0,0 +1,130 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+// PngWriter saves 8 bit RGB or RGBA images as PNG without a zlib
+// dependency: the image data goes into stored (uncompressed) deflate
+// blocks. Files are as large as the raw pixels, but writing is just a
+// copy plus two checksums, cheap enough for frame captures, and any PNG
+// reader (stb_image, image viewers, the golden_compare tool) loads them.
+class PngWriter
+{
+public:
+	// Writes width x height pixels of channels (3 or 4) bytes each, rows top to bottom
+	static bool Write(const char *path, GLuint width, GLuint height, GLuint channels, const unsigned char *pixels)
+	{
+		std::vector<unsigned char> png;
+		Encode(width, height, channels, pixels, png);
+		FILE *file = std::fopen(path, "wb");
+		if (!file)
+			return false;
+		bool written = std::fwrite(&png[0], 1, png.size(), file) == png.size();
+		return std::fclose(file) == 0 && written;
+	}
+	// Encodes the image into png, replacing its content
+	static void Encode(GLuint width, GLuint height, GLuint channels, const unsigned char *pixels, std::vector<unsigned char> &png)
+	{
+		static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		png.assign(signature, signature + 8);
+		unsigned char header[13];
+		put32(header, width);
+		put32(header + 4, height);
+		header[8] = 8;                        // bit depth
+		header[9] = channels == 4 ? 6 : 2;    // RGBA or RGB
+		header[10] = header[11] = header[12] = 0;
+		chunk(png, "IHDR", header, sizeof(header));
+		// zlib stream: header, stored blocks of filter byte + row, adler32 of the raw data
+		size_t row = (size_t)width * channels;
+		std::vector<unsigned char> raw((row + 1) * height);
+		for (GLuint y = 0; y < height; ++y)
+		{
+			raw[y * (row + 1)] = 0; // filter: none
+			std::copy(pixels + y * row, pixels + (y + 1) * row, raw.begin() + y * (row + 1) + 1);
+		}
+		std::vector<unsigned char> zlib;
+		zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+		zlib.push_back(0x78);
+		zlib.push_back(0x01);
+		size_t offset = 0;
+		do
+		{
+			size_t length = std::min<size_t>(65535, raw.size() - offset);
+			zlib.push_back(offset + length == raw.size() ? 1 : 0);
+			zlib.push_back(length & 0xFF);
+			zlib.push_back((length >> 8) & 0xFF);
+			zlib.push_back(~length & 0xFF);
+			zlib.push_back((~length >> 8) & 0xFF);
+			zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+			offset += length;
+		} while (offset < raw.size());
+		unsigned char adler[4];
+		put32(adler, adler32(&raw[0], raw.size()));
+		zlib.insert(zlib.end(), adler, adler + 4);
+		chunk(png, "IDAT", &zlib[0], zlib.size());
+		chunk(png, "IEND", NULL, 0);
+	}
+private:
+	static void put32(unsigned char *out, uint32_t value)
+	{
+		out[0] = (unsigned char)(value >> 24);
+		out[1] = (unsigned char)(value >> 16);
+		out[2] = (unsigned char)(value >> 8);
+		out[3] = (unsigned char)value;
+	}
+	static void chunk(std::vector<unsigned char> &png, const char *type, const unsigned char *data, size_t length)
+	{
+		unsigned char word[4];
+		put32(word, (uint32_t)length);
+		png.insert(png.end(), word, word + 4);
+		size_t start = png.size();
+		png.insert(png.end(), type, type + 4);
+		if (length)
+			png.insert(png.end(), data, data + length);
+		put32(word, crc32(&png[start], png.size() - start));
+		png.insert(png.end(), word, word + 4);
+	}
+	static uint32_t crc32(const unsigned char *data, size_t length)
+	{
+		static const std::vector<uint32_t> table = crcTable(); // initialized once, also across threads
+		uint32_t crc = 0xFFFFFFFFu;
+		for (size_t i = 0; i < length; ++i)
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		return crc ^ 0xFFFFFFFFu;
+	}
+	static std::vector<uint32_t> crcTable()
+	{
+		std::vector<uint32_t> table(256);
+		for (uint32_t n = 0; n < 256; ++n)
+		{
+			uint32_t c = n;
+			for (int k = 0; k < 8; ++k)
+				c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+			table[n] = c;
+		}
+		return table;
+	}
+	static uint32_t adler32(const unsigned char *data, size_t length)
+	{
+		uint32_t a = 1, b = 0;
+		while (length > 0)
+		{
+			// 5552 bytes is the most that can be summed before the 32 bit sums overflow
+			size_t block = std::min<size_t>(length, 5552);
+			length -= block;
+			for (size_t i = 0; i < block; ++i)
+			{
+				a += *data++;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+		}
+		return (b << 16) | a;
+	}
+};
+
+#endif
@@ -0,0 +1,194 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#include <process.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <common/GLState.h>
+
+// ProgramCache keeps linked programs on disk (glGetProgramBinary) so
+// later launches skip compiling and linking GLSL. An entry is named by
+// a 64 bit FNV-1a hash of the exact sources given to the compiler,
+// defines included, of link settings such as transform feedback
+// varyings, and of the GL vendor, renderer and version strings,
+// so a driver update or an edited shader simply misses. A binary the
+// driver rejects is dropped and the program is compiled from source,
+// which then stores a fresh one. Entries are written to a temporary
+// file and renamed into place, readers never see half a file.
+// Needs GL 4.1 or ARB_get_program_binary and at least one binary
+// format, without them every call is a miss. All functions are static.
+class ProgramCache
+{
+public:
+	// Lookups since startup
+	struct Counters
+	{
+		GLuint Hits;     // programs loaded from a binary
+		GLuint Misses;   // programs compiled from source (no entry, or caching off)
+		GLuint Rejected; // binaries the driver refused, counted as misses too
+		GLuint Stored;
+		Counters() : Hits(0), Misses(0), Rejected(0), Stored(0) { }
+	};
+	// Directory of the cache files, created when missing; an empty path turns caching off
+	static void SetDirectory(const std::string &directory)
+	{
+		State &state = current();
+		state.Directory = directory;
+		if (!directory.empty())
+		{
+#ifdef _WIN32
+			_mkdir(directory.c_str());
+#else
+			mkdir(directory.c_str(), 0755);
+#endif
+		}
+	}
+	// True when programs are looked up and stored
+	static bool Enabled()
+	{
+		State &state = current();
+		if (state.Directory.empty() || glGetProgramBinary == NULL || glProgramBinary == NULL)
+			return false;
+		if (state.Formats < 0)
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &state.Formats);
+		return state.Formats > 0;
+	}
+	// Cache key of a program built from the given parts: stage sources and link settings
+	static std::string Key(const std::vector<std::string> &parts)
+	{
+		State &state = current();
+		if (state.Driver.empty())
+		{
+			const GLubyte *strings[3] = { glGetString(GL_VENDOR), glGetString(GL_RENDERER), glGetString(GL_VERSION) };
+			for (int i = 0; i < 3; ++i)
+				state.Driver += std::string(strings[i] ? (const char*)strings[i] : "") + '\n';
+		}
+		uint64_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i <= parts.size(); ++i)
+		{
+			const std::string &part = i == 0 ? state.Driver : parts[i - 1];
+			// the separator keeps "ab" + "c" and "a" + "bc" apart
+			for (size_t c = 0; c < part.size(); ++c)
+				hash = (hash ^ (unsigned char)part[c]) * 1099511628211ull;
+			hash = (hash ^ 0xFF) * 1099511628211ull;
+		}
+		char key[17];
+		std::snprintf(key, sizeof(key), "%016llx", (unsigned long long)hash);
+		return key;
+	}
+	// Loads the entry of key into program and links it; false when there is none or the driver rejects it
+	static bool Load(GLuint program, const std::string &key)
+	{
+		State &state = current();
+		if (!Enabled())
+		{
+			state.Total.Misses++;
+			return false;
+		}
+		std::ifstream file(path(key).c_str(), std::ios::binary);
+		std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (data.size() <= sizeof(GLenum))
+		{
+			state.Total.Misses++;
+			return false;
+		}
+		GLenum format = *(const GLenum*)&data[0];
+		glProgramBinary(program, format, &data[sizeof(GLenum)], (GLsizei)(data.size() - sizeof(GLenum)));
+		GLint linked = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked)
+		{
+			std::remove(path(key).c_str());
+			state.Total.Rejected++;
+			state.Total.Misses++;
+			return false;
+		}
+		state.Total.Hits++;
+		return true;
+	}
+	// Call before linking a program that will be stored, some drivers only keep binaries on request
+	static void PrepareLink(GLuint program)
+	{
+		if (Enabled())
+			glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+	// Writes the binary of the linked program as the entry of key
+	static void Store(GLuint program, const std::string &key)
+	{
+		if (!Enabled())
+			return;
+		GLint length = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		std::vector<char> data(sizeof(GLenum) + length);
+		GLenum format = 0;
+		glGetProgramBinary(program, length, &length, &format, &data[sizeof(GLenum)]);
+		*(GLenum*)&data[0] = format;
+		// the temporary file is per process, launches storing the same entry must not share one
+		std::string target = path(key), temporary = target + "." + std::to_string(processId()) + ".tmp";
+		bool written;
+		{
+			std::ofstream file(temporary.c_str(), std::ios::binary);
+			file.write(&data[0], sizeof(GLenum) + length);
+			file.close();
+			written = !file.fail();
+		}
+		if (!written)
+		{
+			std::remove(temporary.c_str());
+			return;
+		}
+#ifdef _WIN32
+		// rename does not replace existing files on Windows; elsewhere it does so atomically
+		std::remove(target.c_str());
+#endif
+		if (std::rename(temporary.c_str(), target.c_str()) == 0)
+			current().Total.Stored++;
+		else
+			std::remove(temporary.c_str());
+	}
+	static Counters Total()
+	{
+		return current().Total;
+	}
+private:
+	struct State
+	{
+		std::string Directory;
+		std::string Driver;
+		GLint Formats;
+		Counters Total;
+		State() : Formats(-1) { }
+	};
+	static State &current()
+	{
+		static State state;
+		return state;
+	}
+	static std::string path(const std::string &key)
+	{
+		return current().Directory + "/" + key + ".bin";
+	}
+	static long processId()
+	{
+#ifdef _WIN32
+		return (long)_getpid();
+#else
+		return (long)getpid();
+#endif
+	}
+};
+
+#endif
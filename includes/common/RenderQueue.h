@@ -0,0 +1,247 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <common/SpriteBatch.h>
+#include <common/CommandList.h>
+#include <common/GpuProfiler.h>
+
+// RenderQueue collects the sprite draws of a frame instead of issuing
+// them in program order. Every draw carries a 64-bit sort key (see
+// CommandList::MakeKey) so that after an LSD radix sort the opaque and
+// cutout draws come first, grouped by material and front to back, and
+// the translucent ones follow back to front. Flush() draws the first
+// group with depth test and writes but without blending, so hidden
+// pixels are rejected before shading, then blends the rest over it
+// with depth test but no writes. Sprites are placed in depth by layer
+// (higher is nearer), then by depth within the layer. The sort is
+// stable, draws with equal keys keep their submission order. Draws are
+// either submitted directly or recorded into CommandLists (e.g. by
+// worker threads) and appended; Flush() merges everything and replays
+// it through a SpriteBatch. The target needs a depth buffer.
+class RenderQueue
+{
+public:
+	// State changes of the last flushed frame, in submission and in sorted order
+	struct Stats
+	{
+		GLuint Draws;
+		GLuint OpaqueDraws; // opaque and cutout
+		GLuint SubmittedStateChanges;
+		GLuint SortedStateChanges;
+		Stats() : Draws(0), OpaqueDraws(0), SubmittedStateChanges(0), SortedStateChanges(0) { }
+		// State changes the sort saved
+		GLint Removed() const
+		{
+			return (GLint)this->SubmittedStateChanges - (GLint)this->SortedStateChanges;
+		}
+	};
+	Stats LastFrame;
+	// Constructor
+	RenderQueue() : opaqueCount(0), prepared(false) { }
+	// Queues a sprite, parameters after depth are the same as SpriteBatch::DrawSprite
+	void Submit(GLuint layer, SpriteMaterial material, GLfloat depth, Texture2D &texture, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->direct.Draw(layer, material, depth, texture, position, size, rotate, color, yRot);
+	}
+	void Submit(GLuint layer, SpriteMaterial material, GLfloat depth, const AtlasRegion &region, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->direct.Draw(layer, material, depth, region, position, size, rotate, color, yRot);
+	}
+	void Submit(GLuint layer, SpriteMaterial material, GLfloat depth, const TextureLayer &textureLayer, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->direct.Draw(layer, material, depth, textureLayer, position, size, rotate, color, yRot);
+	}
+	void Submit(GLuint layer, SpriteMaterial material, GLfloat depth, const SpriteShape &shape, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->direct.Draw(layer, material, depth, shape, position, size, rotate, color, yRot);
+	}
+	// Adds the packets of a recorded list; the list must stay untouched until Flush()
+	void Append(const CommandList &list)
+	{
+		this->lists.push_back(&list);
+	}
+	// Merges and sorts all queued draws without submitting them
+	void Prepare()
+	{
+		this->packets.clear();
+		this->keys.clear();
+		this->gather(this->direct);
+		for (size_t i = 0; i < this->lists.size(); ++i)
+			this->gather(*this->lists[i]);
+		size_t count = this->packets.size();
+		this->order.resize(count);
+		for (size_t i = 0; i < count; ++i)
+			this->order[i] = (uint32_t)i;
+		Stats stats;
+		stats.Draws = (GLuint)count;
+		stats.SubmittedStateChanges = this->countStateChanges(false);
+		Sort(this->keys, this->order, this->scratchKeys, this->scratchOrder);
+		stats.SortedStateChanges = this->countStateChanges(true);
+		this->opaqueCount = 0;
+		while (this->opaqueCount < count && !CommandList::IsTranslucent(this->keys[this->opaqueCount]))
+			this->opaqueCount++;
+		stats.OpaqueDraws = (GLuint)this->opaqueCount;
+		this->LastFrame = stats;
+		this->prepared = true;
+	}
+	// True if an opaque (not cutout) sprite covers the axis aligned rectangle, so clearing it
+	// is unnecessary. Valid after Prepare().
+	bool OpaqueCovers(glm::vec2 position, glm::vec2 size) const
+	{
+		for (size_t i = 0; i < this->opaqueCount; ++i)
+		{
+			const DrawPacket &packet = this->Sorted(i);
+			if ((packet.Key >> 62) != 0)
+				break; // cutout sprites follow the opaque ones
+			const SpriteAffine &a = packet.Affine;
+			if (a.B != 0.0f || a.C != 0.0f)
+				continue; // rotated
+			glm::vec2 from = glm::min(glm::vec2(a.Tx, a.Ty), glm::vec2(a.Tx + a.A, a.Ty + a.D));
+			glm::vec2 to = glm::max(glm::vec2(a.Tx, a.Ty), glm::vec2(a.Tx + a.A, a.Ty + a.D));
+			if (from.x <= position.x && from.y <= position.y && to.x >= position.x + size.x && to.y >= position.y + size.y)
+				return true;
+		}
+		return false;
+	}
+	// Sorts the queued draws (unless Prepare() was called), submits them to batch (between
+	// its Begin and End) in an opaque and a translucent pass and empties the queue. Blending
+	// is left enabled, depth testing disabled.
+	void Flush(SpriteBatch &batch)
+	{
+		if (!this->prepared)
+			this->Prepare();
+		size_t count = this->order.size();
+		// Opaque pass: depth test and writes, no blending; cutout sprites discard by alpha
+		GpuProfiler::Begin("opaque");
+		GLState::Disable(GL_BLEND);
+		GLState::Enable(GL_DEPTH_TEST);
+		GLState::DepthFunc(GL_LEQUAL);
+		GLState::DepthMask(GL_TRUE);
+		batch.SetAlphaCutoff(0.0f);
+		for (size_t i = 0; i < this->opaqueCount; ++i)
+		{
+			const DrawPacket &packet = this->Sorted(i);
+			if ((packet.Key >> 62) != 0)
+				batch.SetAlphaCutoff(CutoutAlpha);
+			batch.DrawAffine(packet.Target, packet.Texture, packet.Layer, packet.UV, packet.Affine, packet.Color, packet.Depth);
+		}
+		batch.Flush();
+		GpuProfiler::End();
+		// Translucent pass: tested against the opaque depth but not writing it
+		GpuProfiler::Begin("translucent");
+		GLState::Enable(GL_BLEND);
+		GLState::DepthMask(GL_FALSE);
+		batch.SetAlphaCutoff(0.0f);
+		for (size_t i = this->opaqueCount; i < count; ++i)
+		{
+			const DrawPacket &packet = this->Sorted(i);
+			batch.DrawAffine(packet.Target, packet.Texture, packet.Layer, packet.UV, packet.Affine, packet.Color, packet.Depth);
+		}
+		batch.Flush();
+		GpuProfiler::End();
+		GLState::DepthMask(GL_TRUE);
+		GLState::Disable(GL_DEPTH_TEST);
+		this->Clear();
+	}
+	// Drops all queued draws and appended lists
+	void Clear()
+	{
+		this->direct.Reset();
+		this->lists.clear();
+		this->prepared = false;
+	}
+	// Packets in sorted order, valid after Prepare() until the next Clear()
+	size_t Size() const
+	{
+		return this->order.size();
+	}
+	const DrawPacket &Sorted(size_t i) const
+	{
+		return *this->packets[this->order[i]];
+	}
+	// Stable LSD radix sort of keys (8 bits per pass), permuting values alongside. The
+	// histograms of all passes are built in one read, passes whose byte is the same for
+	// every key are skipped.
+	static void Sort(std::vector<uint64_t> &keys, std::vector<uint32_t> &values, std::vector<uint64_t> &scratchKeys, std::vector<uint32_t> &scratchValues)
+	{
+		size_t count = keys.size();
+		if (count < 2)
+			return;
+		scratchKeys.resize(count);
+		scratchValues.resize(count);
+		std::vector<size_t> histograms(8 * 256, 0);
+		for (size_t i = 0; i < count; ++i)
+		{
+			uint64_t key = keys[i];
+			for (GLuint pass = 0; pass < 8; ++pass)
+				histograms[pass * 256 + ((key >> (pass * 8)) & 0xFF)]++;
+		}
+		for (GLuint pass = 0; pass < 8; ++pass)
+		{
+			size_t *offsets = &histograms[pass * 256];
+			GLuint shift = pass * 8;
+			if (offsets[(keys[0] >> shift) & 0xFF] == count)
+				continue;
+			size_t sum = 0;
+			for (GLuint b = 0; b < 256; ++b)
+			{
+				size_t n = offsets[b];
+				offsets[b] = sum;
+				sum += n;
+			}
+			const uint64_t *sourceKeys = &keys[0];
+			const uint32_t *sourceValues = &values[0];
+			uint64_t *targetKeys = &scratchKeys[0];
+			uint32_t *targetValues = &scratchValues[0];
+			for (size_t i = 0; i < count; ++i)
+			{
+				size_t slot = offsets[(sourceKeys[i] >> shift) & 0xFF]++;
+				targetKeys[slot] = sourceKeys[i];
+				targetValues[slot] = sourceValues[i];
+			}
+			keys.swap(scratchKeys);
+			values.swap(scratchValues);
+		}
+	}
+private:
+	// Alpha below which cutout sprites are discarded
+	static constexpr GLfloat CutoutAlpha = 0.5f;
+	// Draws submitted directly, and lists appended this frame
+	CommandList direct;
+	std::vector<const CommandList*> lists;
+	// Merged packets, their keys and the sorted order
+	std::vector<const DrawPacket*> packets;
+	std::vector<uint64_t> keys, scratchKeys;
+	std::vector<uint32_t> order, scratchOrder;
+	size_t opaqueCount;
+	bool prepared;
+	void gather(const CommandList &list)
+	{
+		const std::vector<DrawPacket> &source = list.Packets();
+		for (size_t i = 0; i < source.size(); ++i)
+		{
+			this->packets.push_back(&source[i]);
+			this->keys.push_back(source[i].Key);
+		}
+	}
+	// Number of program or texture switches when drawing in submission or sorted order
+	GLuint countStateChanges(bool sorted) const
+	{
+		GLuint changes = 0;
+		for (size_t i = 1; i < this->packets.size(); ++i)
+		{
+			const DrawPacket &previous = *this->packets[sorted ? this->order[i - 1] : i - 1];
+			const DrawPacket &current = *this->packets[sorted ? this->order[i] : i];
+			if (previous.Target != current.Target || previous.Texture != current.Texture)
+				changes++;
+		}
+		return changes;
+	}
+};
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef RENDER_TARGET_H
+#define RENDER_TARGET_H
+
+#include <iostream>
+
+#include <common/GLState.h>
+#include <common/Texture.h>
+
+// RenderTarget is an offscreen framebuffer with a color texture and an
+// optional depth renderbuffer. The color texture is a regular
+// Texture2D, so it can be sampled like any sprite.
+class RenderTarget
+{
+public:
+	// Holds the ID of the framebuffer object
+	GLuint ID;
+	// Attachments
+	Texture2D Color;
+	GLuint Depth; // depth renderbuffer, 0 without depth
+	// Size in pixels
+	GLuint Width, Height;
+	// Constructor (creates the framebuffer, call Generate to allocate storage)
+	RenderTarget()
+		: Depth(0), Width(0), Height(0)
+	{
+		glGenFramebuffers(1, &this->ID);
+		this->Color.Internal_Format = GL_RGBA8;
+		this->Color.Image_Format = GL_RGBA;
+		this->Color.Wrap_S = GL_CLAMP_TO_EDGE;
+		this->Color.Wrap_T = GL_CLAMP_TO_EDGE;
+	}
+	RenderTarget(const RenderTarget&) = delete;
+	RenderTarget &operator=(const RenderTarget&) = delete;
+	// Destructor
+	~RenderTarget()
+	{
+		glDeleteFramebuffers(1, &this->ID);
+		GLState::ForgetFramebuffer(this->ID);
+		this->Color.Delete();
+		if (this->Depth)
+			glDeleteRenderbuffers(1, &this->Depth);
+	}
+	// (Re)allocates the attachments for the given size
+	void Generate(GLuint width, GLuint height, GLboolean depth = GL_FALSE)
+	{
+		this->Width = width;
+		this->Height = height;
+		this->Color.Generate(width, height, NULL);
+		GLState::BindFramebuffer(GL_FRAMEBUFFER, this->ID);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, this->Color.ID, 0);
+		if (depth)
+		{
+			if (!this->Depth)
+				glGenRenderbuffers(1, &this->Depth);
+			glBindRenderbuffer(GL_RENDERBUFFER, this->Depth);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->Depth);
+		}
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::RENDERTARGET: Framebuffer is not complete" << std::endl;
+	}
+	// Binds the framebuffer for drawing and sets the viewport to cover it
+	void Bind() const
+	{
+		GLState::BindFramebuffer(GL_FRAMEBUFFER, this->ID);
+		GLState::Viewport(0, 0, this->Width, this->Height);
+	}
+	// Copies the color attachment into the given rectangle of framebuffer (no blending)
+	void BlitTo(GLuint framebuffer, GLint x, GLint y, GLsizei width, GLsizei height, GLenum filter = GL_NEAREST) const
+	{
+		GLState::BindFramebuffer(GL_READ_FRAMEBUFFER, this->ID);
+		GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+		glBlitFramebuffer(0, 0, this->Width, this->Height, x, y, x + width, y + height, GL_COLOR_BUFFER_BIT, filter);
+	}
+};
+
+#endif
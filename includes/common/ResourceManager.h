@@ -3,9 +3,13 @@
 
 #include <map>
 #include <string>
+#include <tuple>
+#include <vector>
 
 #include <common/Texture.h>
 #include <common/Shader.h>
+#include <common/TextureAtlas.h>
+#include <common/TextureArray.h>
 
 #include <iostream>
 #include <sstream>
@@ -25,12 +29,44 @@ public:
 	// Resource storage
 	static std::map<std::string, Shader>    Shaders;
 	static std::map<std::string, Texture2D> Textures;
+	static std::map<std::string, TextureAtlas> Atlases;
+	static std::map<std::string, TextureLayer> TextureLayers;
+	static std::vector<TextureArray> TextureArrays;
 
 	// Loads (and generates) a shader program from file loading vertex, fragment (and geometry) shader's source code. If gShaderFile is not nullptr, it also loads a geometry shader
 	static Shader LoadShader(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile, std::string name){
 		Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile);
 		return Shaders[name];
 	}
+	// Same without waiting for the driver, the stored shader can draw once its Ready() is true
+	static Shader SubmitShader(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile, std::string name){
+		Shaders[name] = loadShaderFromFile(vShaderFile, fShaderFile, gShaderFile, GL_TRUE);
+		return Shaders[name];
+	}
+	// Submits a vertex-only program whose outputs are captured by transform feedback, in varyings order
+	static Shader SubmitFeedbackShader(const GLchar *vShaderFile, const std::vector<std::string> &varyings, std::string name){
+		std::string vertexCode = readShaderFile(vShaderFile);
+		Shader shader;
+		shader.SetFeedbackVaryings(varyings);
+		shader.Submit(vertexCode.c_str(), nullptr);
+		Shaders[name] = shader;
+		return shader;
+	}
+	// Submits a compute program (GL 4.3)
+	static Shader SubmitComputeShader(const GLchar *cShaderFile, std::string name){
+		std::string computeCode = readShaderFile(cShaderFile);
+		Shader shader;
+		shader.SubmitCompute(computeCode.c_str());
+		Shaders[name] = shader;
+		return shader;
+	}
+	// True while any stored shader is still being compiled by the driver
+	static bool ShadersCompiling(){
+		bool compiling = false;
+		for (auto &iter : Shaders)
+			compiling = iter.second.Compiling() || compiling;
+		return compiling;
+	}
 	// Retrieves a stored sader
 	static Shader GetShader(std::string name){
 		return Shaders[name];
@@ -45,6 +81,75 @@ public:
 		return Textures[name];
 	}
 
+	// Loads an image that is pooled into a texture array together with all other
+	// layer images of the same size and format; available after BuildTextureArrays
+	static void LoadTextureLayer(const GLchar *file, GLboolean alpha, std::string name){
+		PendingLayer layer;
+		layer.Name = name;
+		layer.Format = alpha ? GL_RGBA : GL_RGB;
+		int width, height;
+		layer.Pixels = SOIL_load_image(file, &width, &height, 0, alpha ? SOIL_LOAD_RGBA : SOIL_LOAD_RGB);
+		if (layer.Pixels == nullptr)
+		{
+			std::cout << "ERROR::TEXTURE: Failed to load texture layer " << file << std::endl;
+			return;
+		}
+		layer.Width = width;
+		layer.Height = height;
+		PendingLayers.push_back(layer);
+	}
+	// Uploads the pending layers, one GL_TEXTURE_2D_ARRAY per size and format
+	static void BuildTextureArrays(){
+		std::map<std::tuple<GLuint, GLuint, GLuint>, std::vector<PendingLayer*> > pools;
+		for (auto &layer : PendingLayers)
+			pools[std::make_tuple(layer.Width, layer.Height, layer.Format)].push_back(&layer);
+		for (auto &pool : pools)
+		{
+			PendingLayer &first = *pool.second.front();
+			std::vector<unsigned char*> pixels;
+			for (auto layer : pool.second)
+				pixels.push_back(layer->Pixels);
+			TextureArray array;
+			array.Internal_Format = first.Format;
+			array.Image_Format = first.Format;
+			array.Generate(first.Width, first.Height, pixels);
+			TextureArrays.push_back(array);
+			for (GLuint i = 0; i < pool.second.size(); ++i)
+			{
+				TextureLayer handle;
+				handle.ArrayID = array.ID;
+				handle.Layer = i;
+				handle.Width = first.Width;
+				handle.Height = first.Height;
+				TextureLayers[pool.second[i]->Name] = handle;
+			}
+		}
+		for (auto &layer : PendingLayers)
+			SOIL_free_image_data(layer.Pixels);
+		PendingLayers.clear();
+	}
+	// Retrieves a stored texture layer
+	static TextureLayer GetTextureLayer(std::string name){
+		return TextureLayers[name];
+	}
+	// Loads an atlas packed offline (see TextureAtlasBuilder::Save) from its index file
+	static bool LoadAtlas(const GLchar *indexFile, std::string name){
+		TextureAtlas atlas;
+		if (!atlas.Load(indexFile))
+			return false;
+		Atlases[name] = atlas;
+		return true;
+	}
+	// Uploads an atlas packed at runtime
+	static TextureAtlas CreateAtlas(const TextureAtlasBuilder &builder, std::string name){
+		Atlases[name].Generate(builder);
+		return Atlases[name];
+	}
+	// Retrieves a stored atlas
+	static TextureAtlas GetAtlas(std::string name){
+		return Atlases[name];
+	}
+
 	static bool IsPresent(std::string name){
 		if (Textures.count(name))
 			return true;
@@ -58,13 +163,30 @@ public:
 			glDeleteProgram(iter.second.ID);
 		// (Properly) delete all textures
 		for (auto iter : Textures)
-			glDeleteTextures(1, &iter.second.ID);
+			iter.second.Delete();
+		// (Properly) delete all texture arrays
+		for (auto iter : TextureArrays)
+			iter.Delete();
+		// (Properly) delete all atlas pages
+		for (auto iter : Atlases)
+			for (auto page : iter.second.Pages)
+				page.Delete();
+		// Deleted objects may be reused by new ones, so the cached bindings are no longer valid
+		GLState::Invalidate();
 	}
 private:
+	// Image data waiting for BuildTextureArrays
+	struct PendingLayer
+	{
+		std::string Name;
+		GLuint Width, Height, Format;
+		unsigned char *Pixels;
+	};
+	static std::vector<PendingLayer> PendingLayers;
 	// Private constructor, that is we do not want any actual resource manager objects. Its members and functions should be publicly available (static).
 	ResourceManager() { }
 	// Loads and generates a shader from file
-	static Shader loadShaderFromFile(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile)
+	static Shader loadShaderFromFile(const GLchar *vShaderFile, const GLchar *fShaderFile, const GLchar *gShaderFile, GLboolean submit = GL_FALSE)
 	{
 		// 1. Retrieve the vertex/fragment source code from filePath
 		std::string vertexCode;
@@ -104,9 +226,22 @@ private:
 		const GLchar *gShaderCode = geometryCode.c_str();
 		// 2. Now create shader object from source code
 		Shader shader;
-		shader.Compile(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
+		if (submit)
+			shader.Submit(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
+		else
+			shader.Compile(vShaderCode, fShaderCode, gShaderFile != nullptr ? gShaderCode : nullptr);
 		return shader;
 	}
+	// Reads one shader source file, empty when it cannot be read
+	static std::string readShaderFile(const GLchar *file)
+	{
+		std::ifstream stream(file);
+		if (!stream)
+			std::cout << "ERROR::SHADER: Failed to read shader file " << file << std::endl;
+		std::stringstream code;
+		code << stream.rdbuf();
+		return code.str();
+	}
 	// Loads a single texture from file
 	static Texture2D loadTextureFromFile(const GLchar *file, GLboolean alpha)
 	{
@@ -121,6 +256,16 @@ private:
 		// stbi_set_flip_vertically_on_load(true); // tell stb_image.h to flip loaded texture's on the y-axis.
 		int width, height;
 		unsigned char* image = SOIL_load_image(file, &width, &height, 0, texture.Image_Format == GL_RGBA ? SOIL_LOAD_RGBA : SOIL_LOAD_RGB);
+		if (image == nullptr)
+		{
+			// width and height are undefined here, a 1x1 magenta texture stands in for the missing file
+			std::cout << "ERROR::TEXTURE: Failed to load texture " << file << std::endl;
+			unsigned char missing[4] = { 255, 0, 255, 255 };
+			texture.Internal_Format = GL_RGBA;
+			texture.Image_Format = GL_RGBA;
+			texture.Generate(1, 1, missing);
+			return texture;
+		}
 		// Now generate texture
 		texture.Generate(width, height, image);
 		// And finally free image data
@@ -0,0 +1,266 @@
+#ifndef SDF_FONT_H
+#define SDF_FONT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <common/Texture.h>
+#include <common/TextureAtlas.h>
+#include <common/BitmapFont.h>
+
+// A glyph of an SdfFont. Rectangle and metrics are in texels of the
+// font page; bearings place the rectangle relative to the pen, which
+// sits at the top left of the line.
+struct SdfGlyph
+{
+	GLuint X, Y, Width, Height; // in the page, zero sized for blanks
+	GLint BearingX, BearingY;
+	GLuint Advance;
+	glm::vec4 UV;
+	SdfGlyph() : X(0), Y(0), Width(0), Height(0), BearingX(0), BearingY(0), Advance(0), UV(0.0f) { }
+};
+
+// Builds the single channel signed distance page of the BitmapFont,
+// offline (src/tools/font_builder writes it as a .font file) or at
+// startup when no file is there. Every font pixel is TexelsPerPixel
+// texels wide and the distance to the nearest pixel edge, stored
+// around 128 and reaching 0 and 255 at Spread texels, is exact: it is
+// measured to the pixel squares, not approximated from a raster.
+class SdfFontBuilder
+{
+public:
+	// Page pixel data (PageWidth x PageHeight, one byte per texel)
+	std::vector<unsigned char> Pixels;
+	std::map<GLuint, SdfGlyph> Glyphs;
+	GLuint PageWidth, PageHeight;
+	GLuint TexelsPerPixel, Spread, Padding;
+	GLuint LineHeight;
+	// Constructor
+	SdfFontBuilder(GLuint texelsPerPixel = 8, GLuint spread = 6, GLuint pageWidth = 512, GLuint pageHeight = 512)
+		: PageWidth(pageWidth), PageHeight(pageHeight), TexelsPerPixel(texelsPerPixel), Spread(spread), Padding(1),
+		  LineHeight((BitmapFontHeight + 2) * texelsPerPixel) { }
+	// Texels over which the stored distance goes from 0 to 255
+	GLfloat DistanceRange() const
+	{
+		return 2.0f * this->Spread;
+	}
+	// Rasterizes every glyph of the BitmapFont; returns false if they do not fit on the page
+	bool Build()
+	{
+		this->Pixels.assign(this->PageWidth * this->PageHeight, 0);
+		this->Glyphs.clear();
+		SkylinePacker packer(this->PageWidth, this->PageHeight);
+		GLuint t = this->TexelsPerPixel;
+		// a blank a bit over half a glyph wide
+		SdfGlyph space;
+		space.Advance = 3 * t;
+		this->Glyphs[' '] = space;
+		for (size_t i = 0; i < sizeof(BitmapFont) / sizeof(BitmapFont[0]); ++i)
+		{
+			const BitmapGlyph &bitmap = BitmapFont[i];
+			// glyphs are proportional, empty columns on either side are trimmed
+			int first = BitmapFontWidth, last = -1;
+			for (int row = 0; row < BitmapFontHeight; ++row)
+				for (int column = 0; column < BitmapFontWidth; ++column)
+					if (bitmap.Rows[row][column] == 'X')
+					{
+						first = std::min(first, column);
+						last = std::max(last, column);
+					}
+			if (last < first)
+				continue;
+			SdfGlyph glyph;
+			glyph.Width = (last - first + 1) * t + 2 * this->Spread;
+			glyph.Height = BitmapFontHeight * t + 2 * this->Spread;
+			GLuint x, y;
+			if (!packer.Insert(glyph.Width + 2 * this->Padding, glyph.Height + 2 * this->Padding, &x, &y))
+			{
+				std::cout << "ERROR::FONT: Glyph " << bitmap.Character << " does not fit on a " << this->PageWidth << "x" << this->PageHeight << " page" << std::endl;
+				return false;
+			}
+			glyph.X = x + this->Padding;
+			glyph.Y = y + this->Padding;
+			glyph.BearingX = -(GLint)this->Spread;
+			glyph.BearingY = (GLint)t - (GLint)this->Spread; // one font pixel below the line top
+			glyph.Advance = (last - first + 2) * t;
+			glyph.UV = glyphUV(glyph, this->PageWidth, this->PageHeight);
+			this->rasterize(bitmap, first, glyph);
+			this->Glyphs[(unsigned char)bitmap.Character] = glyph;
+		}
+		return true;
+	}
+	// Writes the page and the glyphs into one binary .font file
+	bool Save(const std::string &file) const
+	{
+		FILE *out = std::fopen(file.c_str(), "wb");
+		if (out == nullptr)
+		{
+			std::cout << "ERROR::FONT: Failed to write " << file << std::endl;
+			return false;
+		}
+		TextureAtlasBuilder::writeUint(out, FileMagic);
+		TextureAtlasBuilder::writeUint(out, FileVersion);
+		TextureAtlasBuilder::writeUint(out, this->PageWidth);
+		TextureAtlasBuilder::writeUint(out, this->PageHeight);
+		TextureAtlasBuilder::writeUint(out, this->LineHeight);
+		TextureAtlasBuilder::writeUint(out, this->Spread);
+		TextureAtlasBuilder::writeUint(out, (GLuint)this->Glyphs.size());
+		for (std::map<GLuint, SdfGlyph>::const_iterator it = this->Glyphs.begin(); it != this->Glyphs.end(); ++it)
+		{
+			const SdfGlyph &glyph = it->second;
+			TextureAtlasBuilder::writeUint(out, it->first);
+			TextureAtlasBuilder::writeUint(out, glyph.X);
+			TextureAtlasBuilder::writeUint(out, glyph.Y);
+			TextureAtlasBuilder::writeUint(out, glyph.Width);
+			TextureAtlasBuilder::writeUint(out, glyph.Height);
+			TextureAtlasBuilder::writeUint(out, (GLuint)glyph.BearingX);
+			TextureAtlasBuilder::writeUint(out, (GLuint)glyph.BearingY);
+			TextureAtlasBuilder::writeUint(out, glyph.Advance);
+		}
+		std::fwrite(&this->Pixels[0], 1, this->Pixels.size(), out);
+		bool written = std::ferror(out) == 0;
+		std::fclose(out);
+		return written;
+	}
+	// File layout: magic, version, page size, line height, spread, glyphs, then the page texels
+	static const GLuint FileMagic = 0x4E464853; // "SHFN"
+	static const GLuint FileVersion = 1;
+	static glm::vec4 glyphUV(const SdfGlyph &glyph, GLuint pageWidth, GLuint pageHeight)
+	{
+		return glm::vec4((GLfloat)glyph.X / pageWidth, (GLfloat)glyph.Y / pageHeight,
+			(GLfloat)glyph.Width / pageWidth, (GLfloat)glyph.Height / pageHeight);
+	}
+private:
+	// Fills the glyph's rectangle with the signed distance (positive inside) of each texel
+	// center to the set pixels of bitmap, whose column first is the glyph's left edge
+	void rasterize(const BitmapGlyph &bitmap, int first, const SdfGlyph &glyph)
+	{
+		GLfloat t = (GLfloat)this->TexelsPerPixel;
+		for (GLuint j = 0; j < glyph.Height; ++j)
+			for (GLuint i = 0; i < glyph.Width; ++i)
+			{
+				// texel center in font pixels
+				GLfloat px = first + (i + 0.5f - this->Spread) / t;
+				GLfloat py = (j + 0.5f - this->Spread) / t;
+				bool inside = set(bitmap, (int)std::floor(px), (int)std::floor(py));
+				// nearest pixel of the other kind; outside the bitmap counts as unset, one ring of it
+				// is always nearer than anything beyond
+				GLfloat nearest = 1e9f;
+				for (int row = -1; row <= BitmapFontHeight; ++row)
+					for (int column = -1; column <= BitmapFontWidth; ++column)
+					{
+						if (set(bitmap, column, row) == inside)
+							continue;
+						GLfloat dx = std::max(std::max(column - px, px - (column + 1)), 0.0f);
+						GLfloat dy = std::max(std::max(row - py, py - (row + 1)), 0.0f);
+						nearest = std::min(nearest, dx * dx + dy * dy);
+					}
+				GLfloat distance = std::sqrt(nearest) * t * (inside ? 1.0f : -1.0f);
+				GLfloat value = 0.5f + distance / this->DistanceRange();
+				this->Pixels[(glyph.Y + j) * this->PageWidth + glyph.X + i] = (unsigned char)glm::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f);
+			}
+	}
+	static bool set(const BitmapGlyph &bitmap, int column, int row)
+	{
+		return column >= 0 && column < BitmapFontWidth && row >= 0 && row < BitmapFontHeight && bitmap.Rows[row][column] == 'X';
+	}
+};
+
+// GPU side of a distance field font: the uploaded page and the glyphs.
+// Scaled quads of the page are drawn by TextRenderer.
+class SdfFont
+{
+public:
+	Texture2D Page;
+	std::map<GLuint, SdfGlyph> Glyphs;
+	GLuint LineHeight;
+	GLfloat DistanceRange;
+	// Constructor
+	SdfFont() : LineHeight(0), DistanceRange(1.0f) { }
+	// Uploads the page built by builder
+	void Generate(const SdfFontBuilder &builder)
+	{
+		this->Glyphs = builder.Glyphs;
+		this->LineHeight = builder.LineHeight;
+		this->DistanceRange = builder.DistanceRange();
+		this->upload(builder.PageWidth, builder.PageHeight, &builder.Pixels[0]);
+	}
+	// Loads a .font file written by SdfFontBuilder::Save
+	bool Load(const GLchar *file)
+	{
+		FILE *in = std::fopen(file, "rb");
+		if (in == nullptr)
+			return false;
+		GLuint magic = readUint(in), version = readUint(in);
+		if (magic != SdfFontBuilder::FileMagic || version != SdfFontBuilder::FileVersion)
+		{
+			std::cout << "ERROR::FONT: Unsupported font file " << file << std::endl;
+			std::fclose(in);
+			return false;
+		}
+		GLuint pageWidth = readUint(in), pageHeight = readUint(in);
+		this->LineHeight = readUint(in);
+		this->DistanceRange = 2.0f * readUint(in);
+		this->Glyphs.clear();
+		GLuint count = readUint(in);
+		for (GLuint i = 0; i < count; ++i)
+		{
+			GLuint character = readUint(in);
+			SdfGlyph glyph;
+			glyph.X = readUint(in);
+			glyph.Y = readUint(in);
+			glyph.Width = readUint(in);
+			glyph.Height = readUint(in);
+			glyph.BearingX = (GLint)readUint(in);
+			glyph.BearingY = (GLint)readUint(in);
+			glyph.Advance = readUint(in);
+			glyph.UV = SdfFontBuilder::glyphUV(glyph, pageWidth, pageHeight);
+			this->Glyphs[character] = glyph;
+		}
+		std::vector<unsigned char> pixels(pageWidth * pageHeight);
+		bool complete = !pixels.empty() && std::fread(&pixels[0], 1, pixels.size(), in) == pixels.size();
+		std::fclose(in);
+		if (!complete)
+		{
+			std::cout << "ERROR::FONT: Truncated font file " << file << std::endl;
+			this->Glyphs.clear();
+			return false;
+		}
+		this->upload(pageWidth, pageHeight, &pixels[0]);
+		return true;
+	}
+	// Glyph of a character, its upper case form when only that exists; nullptr if there is none
+	const SdfGlyph *Find(GLuint character) const
+	{
+		std::map<GLuint, SdfGlyph>::const_iterator it = this->Glyphs.find(character);
+		if (it == this->Glyphs.end() && character >= 'a' && character <= 'z')
+			it = this->Glyphs.find(character - 'a' + 'A');
+		return it == this->Glyphs.end() ? nullptr : &it->second;
+	}
+private:
+	void upload(GLuint width, GLuint height, const unsigned char *pixels)
+	{
+		this->Page.Internal_Format = GL_R8;
+		this->Page.Image_Format = GL_RED;
+		this->Page.Wrap_S = GL_CLAMP_TO_EDGE;
+		this->Page.Wrap_T = GL_CLAMP_TO_EDGE;
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		this->Page.Generate(width, height, const_cast<unsigned char*>(pixels));
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	}
+	static GLuint readUint(FILE *file)
+	{
+		unsigned char bytes[4] = { 0, 0, 0, 0 };
+		if (std::fread(bytes, 1, 4, file) != 4)
+			return 0;
+		return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((GLuint)bytes[3] << 24);
+	}
+};
+
+#endif
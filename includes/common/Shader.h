@@ -2,124 +2,354 @@
 #define SHADER_H
 
 #include <string>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 #include <iostream>
 
+#include <common/GLState.h>
+#include <common/FrameConstants.h>
+#include <common/ProgramCache.h>
+
+// GL_KHR_parallel_shader_compile, not in the generated loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Location of a uniform in one program, as returned by Shader::GetUniform.
+// Setting a handle skips the name lookup entirely.
+struct UniformHandle
+{
+	GLint Location;
+	UniformHandle(GLint location = -1) : Location(location) { }
+	bool Valid() const { return this->Location >= 0; }
+};
 
 // General purpsoe shader object. Compiles from file, generates
 // compile/link-time error messages and hosts several utility
-// functions for easy management.
+// functions for easy management. The active uniforms are reflected
+// once after linking, so name based setters are a table lookup
+// instead of a glGetUniformLocation call. Linked programs go through
+// the ProgramCache when it has a directory. Submit() compiles without
+// waiting so many programs can build in parallel, Ready() tells when
+// one can draw.
 class Shader
 {
 public:
 	// State
 	GLuint ID;
 	// Constructor
-	Shader() { }
-	// Sets the current shader as active
+	Shader() : ID(0) { }
+	// Sets the current shader as active (skipped if it already is)
 	Shader &Use()
 	{
-		glUseProgram(this->ID);
+		GLState::UseProgram(this->ID);
 		return *this;
 	}
-	// Compiles the shader from given source code
+	// Compiles the shader from given source code, waiting for the result
 	void Compile(const GLchar* vertexSource, const GLchar* fragmentSource, const GLchar *geometrySource = nullptr)
 	{
-		GLuint sVertex, sFragment, gShader;
-		// Vertex Shader
-		sVertex = glCreateShader(GL_VERTEX_SHADER);
-		glShaderSource(sVertex, 1, &vertexSource, NULL);
-		glCompileShader(sVertex);
-		checkCompileErrors(sVertex, "VERTEX");
-		// Fragment Shader
-		sFragment = glCreateShader(GL_FRAGMENT_SHADER);
-		glShaderSource(sFragment, 1, &fragmentSource, NULL);
-		glCompileShader(sFragment);
-		checkCompileErrors(sFragment, "FRAGMENT");
+		this->Submit(vertexSource, fragmentSource, geometrySource);
+		this->finish();
+	}
+	// Starts compiling and linking without waiting for the driver. Status and logs are only
+	// read once Ready() says so; uniforms set before then are ignored. The fragment shader
+	// may be null for programs that only feed transform feedback.
+	void Submit(const GLchar* vertexSource, const GLchar* fragmentSource, const GLchar *geometrySource = nullptr)
+	{
+		std::vector<std::pair<GLenum, const GLchar*> > stages;
+		stages.push_back(std::make_pair((GLenum)GL_VERTEX_SHADER, vertexSource));
+		if (fragmentSource != nullptr)
+			stages.push_back(std::make_pair((GLenum)GL_FRAGMENT_SHADER, fragmentSource));
 		// If geometry shader source code is given, also compile geometry shader
 		if (geometrySource != nullptr)
+			stages.push_back(std::make_pair((GLenum)GL_GEOMETRY_SHADER, geometrySource));
+		this->submit(stages);
+	}
+	// Compute program versions of Compile() and Submit() (GL 4.3)
+	void CompileCompute(const GLchar *computeSource)
+	{
+		this->SubmitCompute(computeSource);
+		this->finish();
+	}
+	void SubmitCompute(const GLchar *computeSource)
+	{
+		this->submit(std::vector<std::pair<GLenum, const GLchar*> >(1, std::make_pair((GLenum)GL_COMPUTE_SHADER, computeSource)));
+	}
+	// Outputs written to transform feedback buffers, interleaved in this order; set before compiling
+	void SetFeedbackVaryings(const std::vector<std::string> &varyings)
+	{
+		this->feedbackVaryings = varyings;
+	}
+	// True while the driver is still working on a Submit()ted program. With
+	// GL_KHR_parallel_shader_compile this polls without blocking; without it the first
+	// call waits for the driver.
+	bool Compiling()
+	{
+		if (!this->build || this->build->Done)
+			return false;
+		if (!this->build->Cached && parallelCompile())
 		{
-			gShader = glCreateShader(GL_GEOMETRY_SHADER);
-			glShaderSource(gShader, 1, &geometrySource, NULL);
-			glCompileShader(gShader);
-			checkCompileErrors(gShader, "GEOMETRY");
+			GLint complete = GL_FALSE;
+			glGetProgramiv(this->ID, GL_COMPLETION_STATUS_KHR, &complete);
+			if (!complete)
+				return true;
 		}
-		// Shader Program
-		this->ID = glCreateProgram();
-		glAttachShader(this->ID, sVertex);
-		glAttachShader(this->ID, sFragment);
-		if (geometrySource != nullptr)
-			glAttachShader(this->ID, gShader);
-		glLinkProgram(this->ID);
-		checkCompileErrors(this->ID, "PROGRAM");
-		// Delete the shaders as they're linked into our program now and no longer necessery
-		glDeleteShader(sVertex);
-		glDeleteShader(sFragment);
-		if (geometrySource != nullptr)
-			glDeleteShader(gShader);
+		this->finish();
+		return false;
+	}
+	// True once the program is linked and can draw
+	bool Ready()
+	{
+		if (this->Compiling())
+			return false;
+		return this->build ? this->build->Linked : this->ID != 0;
+	}
+	// Returns a stable handle to the named uniform; unknown names are reported once
+	UniformHandle GetUniform(const GLchar *name)
+	{
+		return UniformHandle(this->location(name));
 	}
 	// Utility functions
 	void SetFloat(const GLchar *name, GLfloat value, GLboolean useShader = false)
 	{
-		if (useShader)
-			this->Use();
-		glUniform1f(glGetUniformLocation(this->ID, name), value);
+		this->SetFloat(this->GetUniform(name), value, useShader);
 	}
 	void SetInteger(const GLchar *name, GLint value, GLboolean useShader = false)
 	{
-		if (useShader)
-			this->Use();
-		glUniform1i(glGetUniformLocation(this->ID, name), value);
+		this->SetInteger(this->GetUniform(name), value, useShader);
 	}
 	void SetVector2f(const GLchar *name, GLfloat x, GLfloat y, GLboolean useShader = false)
 	{
-		if (useShader)
-			this->Use();
-		glUniform2f(glGetUniformLocation(this->ID, name), x, y);
+		this->SetVector2f(this->GetUniform(name), x, y, useShader);
 	}
 	void SetVector2f(const GLchar *name, glm::vec2 value, GLboolean useShader = false)
+	{
+		this->SetVector2f(this->GetUniform(name), value.x, value.y, useShader);
+	}
+	void SetVector3f(const GLchar *name, GLfloat x, GLfloat y, GLfloat z, GLboolean useShader = false)
+	{
+		this->SetVector3f(this->GetUniform(name), x, y, z, useShader);
+	}
+	void SetVector3f(const GLchar *name, glm::vec3 value, GLboolean useShader = false)
+	{
+		this->SetVector3f(this->GetUniform(name), value.x, value.y, value.z, useShader);
+	}
+	void SetVector4f(const GLchar *name, GLfloat x, GLfloat y, GLfloat z, GLfloat w, GLboolean useShader = false)
+	{
+		this->SetVector4f(this->GetUniform(name), x, y, z, w, useShader);
+	}
+	void SetVector4f(const GLchar *name, glm::vec4 value, GLboolean useShader = false)
+	{
+		this->SetVector4f(this->GetUniform(name), value.x, value.y, value.z, value.w, useShader);
+	}
+	void SetMatrix4(const GLchar *name, glm::mat4 matrix, GLboolean useShader = false)
+	{
+		this->SetMatrix4(this->GetUniform(name), matrix, useShader);
+	}
+	// Handle based setters
+	void SetFloat(UniformHandle uniform, GLfloat value, GLboolean useShader = false)
 	{
 		if (useShader)
 			this->Use();
-		glUniform2f(glGetUniformLocation(this->ID, name), value.x, value.y);
+		glUniform1f(uniform.Location, value);
 	}
-	void SetVector3f(const GLchar *name, GLfloat x, GLfloat y, GLfloat z, GLboolean useShader = false)
+	void SetInteger(UniformHandle uniform, GLint value, GLboolean useShader = false)
 	{
 		if (useShader)
 			this->Use();
-		glUniform3f(glGetUniformLocation(this->ID, name), x, y, z);
+		glUniform1i(uniform.Location, value);
 	}
-	void SetVector3f(const GLchar *name, glm::vec3 value, GLboolean useShader = false)
+	void SetVector2f(UniformHandle uniform, GLfloat x, GLfloat y, GLboolean useShader = false)
 	{
 		if (useShader)
 			this->Use();
-		glUniform3f(glGetUniformLocation(this->ID, name), value.x, value.y, value.z);
+		glUniform2f(uniform.Location, x, y);
 	}
-	void SetVector4f(const GLchar *name, GLfloat x, GLfloat y, GLfloat z, GLfloat w, GLboolean useShader = false)
+	void SetVector3f(UniformHandle uniform, GLfloat x, GLfloat y, GLfloat z, GLboolean useShader = false)
 	{
 		if (useShader)
 			this->Use();
-		glUniform4f(glGetUniformLocation(this->ID, name), x, y, z, w);
+		glUniform3f(uniform.Location, x, y, z);
 	}
-	void SetVector4f(const GLchar *name, glm::vec4 value, GLboolean useShader = false)
+	void SetVector3f(UniformHandle uniform, glm::vec3 value, GLboolean useShader = false)
+	{
+		this->SetVector3f(uniform, value.x, value.y, value.z, useShader);
+	}
+	void SetVector4f(UniformHandle uniform, GLfloat x, GLfloat y, GLfloat z, GLfloat w, GLboolean useShader = false)
 	{
 		if (useShader)
 			this->Use();
-		glUniform4f(glGetUniformLocation(this->ID, name), value.x, value.y, value.z, value.w);
+		glUniform4f(uniform.Location, x, y, z, w);
 	}
-	void SetMatrix4(const GLchar *name, glm::mat4 matrix, GLboolean useShader = false)
+	void SetVector4f(UniformHandle uniform, glm::vec4 value, GLboolean useShader = false)
+	{
+		this->SetVector4f(uniform, value.x, value.y, value.z, value.w, useShader);
+	}
+	void SetMatrix4(UniformHandle uniform, const glm::mat4 &matrix, GLboolean useShader = false)
 	{
 		if (useShader)
 			this->Use();
-		glUniformMatrix4fv(glGetUniformLocation(this->ID, name), 1, GL_FALSE, glm::value_ptr(matrix));
+		glUniformMatrix4fv(uniform.Location, 1, GL_FALSE, glm::value_ptr(matrix));
 	}
 
 private:
-	// Checks if compilation or linking failed and if so, print the error logs
-	void checkCompileErrors(GLuint object, std::string type)
+	// Compile and link in progress, shared by all copies of the shader
+	struct Build
+	{
+		std::vector<std::pair<GLenum, GLuint> > Stages; // type, shader object
+		std::string CacheKey;
+		bool Cached, Done, Linked;
+		Build() : Cached(false), Done(false), Linked(false) { }
+	};
+	std::shared_ptr<Build> build;
+	std::vector<std::string> feedbackVaryings;
+	// Uniform name -> location, filled at link time and shared by all copies of the shader.
+	// Unknown names are stored as -1 after their first (reported) lookup.
+	std::shared_ptr<std::unordered_map<std::string, GLint> > uniforms;
+	// Records every active uniform of the linked program
+	void reflectUniforms()
+	{
+		GLint count = 0, maxLength = 0;
+		glGetProgramiv(this->ID, GL_ACTIVE_UNIFORMS, &count);
+		glGetProgramiv(this->ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+		std::string name(maxLength > 0 ? maxLength : 1, '\0');
+		for (GLint i = 0; i < count; ++i)
+		{
+			GLsizei length = 0;
+			GLint size = 0;
+			GLenum type;
+			glGetActiveUniform(this->ID, (GLuint)i, maxLength, &length, &size, &type, &name[0]);
+			std::string uniform = name.substr(0, length);
+			GLint location = glGetUniformLocation(this->ID, uniform.c_str());
+			if (location < 0)
+				continue; // member of a uniform block
+			(*this->uniforms)[uniform] = location;
+			// Arrays are reported as "name[0]", also accept the plain name
+			if (uniform.size() > 3 && uniform.compare(uniform.size() - 3, 3, "[0]") == 0)
+				(*this->uniforms)[uniform.substr(0, uniform.size() - 3)] = location;
+		}
+	}
+	// Attaches the FrameConstants block, if the program declares it, to its binding point
+	void bindFrameConstants()
+	{
+		GLuint block = glGetUniformBlockIndex(this->ID, FrameConstants::BlockName());
+		if (block != GL_INVALID_INDEX)
+			glUniformBlockBinding(this->ID, block, FrameConstants::BindingPoint);
+	}
+	GLint location(const GLchar *name)
+	{
+		if (this->build && !this->build->Done)
+			return -1;
+		if (!this->uniforms)
+			return glGetUniformLocation(this->ID, name);
+		std::unordered_map<std::string, GLint>::iterator it = this->uniforms->find(name);
+		if (it != this->uniforms->end())
+			return it->second;
+		GLint location = glGetUniformLocation(this->ID, name);
+		if (location < 0)
+			std::cout << "| WARNING::SHADER: Unknown uniform '" << name << "' in program " << this->ID << std::endl;
+		(*this->uniforms)[name] = location;
+		return location;
+	}
+	// Compiles the stages and links them, or loads the program from the cache
+	void submit(const std::vector<std::pair<GLenum, const GLchar*> > &stages)
+	{
+		this->uniforms = std::make_shared<std::unordered_map<std::string, GLint> >();
+		this->build = std::make_shared<Build>();
+		std::vector<std::string> key;
+		for (size_t i = 0; i < stages.size(); ++i)
+			key.push_back(std::to_string(stages[i].first) + "\n" + stages[i].second);
+		for (size_t i = 0; i < this->feedbackVaryings.size(); ++i)
+			key.push_back(this->feedbackVaryings[i]);
+		this->build->CacheKey = ProgramCache::Key(key);
+		this->ID = glCreateProgram();
+		// A cached binary replaces compiling and linking altogether
+		if (ProgramCache::Load(this->ID, this->build->CacheKey))
+		{
+			this->build->Cached = true;
+			return;
+		}
+		for (size_t i = 0; i < stages.size(); ++i)
+		{
+			GLuint stage = compileStage(stages[i].first, stages[i].second);
+			glAttachShader(this->ID, stage);
+			this->build->Stages.push_back(std::make_pair(stages[i].first, stage));
+		}
+		if (!this->feedbackVaryings.empty())
+		{
+			std::vector<const GLchar*> names;
+			for (size_t i = 0; i < this->feedbackVaryings.size(); ++i)
+				names.push_back(this->feedbackVaryings[i].c_str());
+			glTransformFeedbackVaryings(this->ID, (GLsizei)names.size(), &names[0], GL_INTERLEAVED_ATTRIBS);
+		}
+		ProgramCache::PrepareLink(this->ID);
+		glLinkProgram(this->ID);
+	}
+	// Creates and compiles one stage, its status is read in finish()
+	static GLuint compileStage(GLenum type, const GLchar *source)
+	{
+		GLuint stage = glCreateShader(type);
+		glShaderSource(stage, 1, &source, NULL);
+		glCompileShader(stage);
+		return stage;
+	}
+	// Reads the results of Submit(): logs errors, reflects the program and stores it in the cache
+	void finish()
+	{
+		Build &build = *this->build;
+		if (build.Done)
+			return;
+		for (size_t i = 0; i < build.Stages.size(); ++i)
+			checkCompileErrors(build.Stages[i].second, stageName(build.Stages[i].first));
+		build.Linked = checkCompileErrors(this->ID, "PROGRAM");
+		if (build.Linked)
+		{
+			this->reflectUniforms();
+			this->bindFrameConstants();
+			if (!build.Cached)
+				ProgramCache::Store(this->ID, build.CacheKey);
+		}
+		// Delete the shaders as they're linked into our program now and no longer necessery
+		for (size_t i = 0; i < build.Stages.size(); ++i)
+			glDeleteShader(build.Stages[i].second);
+		build.Stages.clear();
+		build.Done = true;
+	}
+	static const char *stageName(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_VERTEX_SHADER: return "VERTEX";
+		case GL_FRAGMENT_SHADER: return "FRAGMENT";
+		case GL_GEOMETRY_SHADER: return "GEOMETRY";
+		default: return "COMPUTE";
+		}
+	}
+	// True when the driver compiles and links in the background (KHR or ARB parallel_shader_compile)
+	static bool parallelCompile()
+	{
+		static int supported = -1;
+		if (supported < 0)
+		{
+			supported = 0;
+			GLint count = 0;
+			glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+			for (GLint i = 0; i < count && !supported; ++i)
+			{
+				std::string extension((const char*)glGetStringi(GL_EXTENSIONS, i));
+				supported = extension == "GL_KHR_parallel_shader_compile" || extension == "GL_ARB_parallel_shader_compile";
+			}
+		}
+		return supported == 1;
+	}
+	// Checks if compilation or linking failed and if so, print the error logs; true on success
+	bool checkCompileErrors(GLuint object, std::string type)
 	{
 		GLint success;
 		GLchar infoLog[1024];
@@ -145,6 +375,7 @@ private:
 					<< std::endl;
 			}
 		}
+		return success == GL_TRUE;
 	}
 };
 
@@ -0,0 +1,327 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <common/Texture.h>
+#include <common/Shader.h>
+#include <common/SpriteTransform.h>
+#include <common/TextureAtlas.h>
+#include <common/TextureArray.h>
+#include <common/SpriteShape.h>
+#include <common/StreamBuffer.h>
+
+// SpriteBatch collects all sprites drawn between Begin() and End()
+// as structure-of-arrays sprite parameters. They are only transformed
+// (by SpriteTransform::ComputeAffines) and submitted to OpenGL when
+// the texture changes, the batch is full or End() is called, so a
+// frame costs one draw call per texture change instead of one per
+// sprite. Vertices are written straight into a fenced StreamBuffer
+// ring instead of orphaning a buffer. Layers of texture arrays are
+// drawn with a second shader and share a draw call as long as they
+// come from the same array. SpriteShapes are drawn with a third one
+// that binds no texture, any number of them in one draw call.
+class SpriteBatch
+{
+public:
+	// Maximum number of sprites submitted in a single draw call
+	static const GLuint MaxSprites = 4096;
+	// Statistics of the last completed Begin()/End() pair
+	GLuint DrawCalls;
+	GLuint SpriteCount;
+	// Sprites dropped since creation because their program was still compiling
+	GLuint SkippedSprites;
+	// Constructor (inits shaders/buffers)
+	SpriteBatch(Shader &shader)
+		: DrawCalls(0), SpriteCount(0), SkippedSprites(0), stream(GL_ARRAY_BUFFER, StreamRegionSize), currentTexture(0), currentTarget(GL_TEXTURE_2D), drawing(GL_FALSE), frameDrawCalls(0), frameSprites(0), alphaCutoff(0.0f)
+	{
+		this->shader = shader;
+		this->reserve(MaxSprites);
+		this->initRenderData();
+	}
+	// Constructor that also enables drawing texture array layers
+	SpriteBatch(Shader &shader, Shader &arrayShader)
+		: DrawCalls(0), SpriteCount(0), SkippedSprites(0), stream(GL_ARRAY_BUFFER, StreamRegionSize), currentTexture(0), currentTarget(GL_TEXTURE_2D), drawing(GL_FALSE), frameDrawCalls(0), frameSprites(0), alphaCutoff(0.0f)
+	{
+		this->shader = shader;
+		this->arrayShader = arrayShader;
+		this->reserve(MaxSprites);
+		this->initRenderData();
+	}
+	// Constructor that also enables drawing texture array layers and shapes
+	SpriteBatch(Shader &shader, Shader &arrayShader, Shader &shapeShader)
+		: DrawCalls(0), SpriteCount(0), SkippedSprites(0), stream(GL_ARRAY_BUFFER, StreamRegionSize), currentTexture(0), currentTarget(GL_TEXTURE_2D), drawing(GL_FALSE), frameDrawCalls(0), frameSprites(0), alphaCutoff(0.0f)
+	{
+		this->shader = shader;
+		this->arrayShader = arrayShader;
+		this->shapeShader = shapeShader;
+		this->reserve(MaxSprites);
+		this->initRenderData();
+	}
+	// Destructor
+	~SpriteBatch()
+	{
+		glDeleteVertexArrays(1, &this->VAO);
+		GLState::ForgetVertexArray(this->VAO);
+		glDeleteBuffers(1, &this->EBO);
+		GLState::ForgetBuffer(this->EBO);
+	}
+	// Starts collecting sprites
+	void Begin()
+	{
+		this->drawing = GL_TRUE;
+		this->frameDrawCalls = 0;
+		this->frameSprites = 0;
+		this->currentTexture = 0;
+		this->clear();
+	}
+	// Queues a quad textured with given sprite; same parameters as SpriteRenderer::DrawSprite
+	void DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->queue(GL_TEXTURE_2D, texture.ID, 0, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), position, size, rotate, color, yRot);
+	}
+	// Queues a quad textured with an atlas region; regions of the same page share a draw call
+	void DrawSprite(const AtlasRegion &region, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->queue(GL_TEXTURE_2D, region.TextureID, 0, region.UV, position, size, rotate, color, yRot);
+	}
+	// Queues a quad textured with a texture array layer; layers of the same array share a draw call
+	void DrawSprite(const TextureLayer &layer, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->queue(GL_TEXTURE_2D_ARRAY, layer.ArrayID, layer.Layer, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), position, size, rotate, color, yRot);
+	}
+	// Queues a shape filling the quad; shapes of every kind share a draw call
+	void DrawSprite(const SpriteShape &shape, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->queue(SpriteShape::Target, 0, shape.Packed(), SpriteShape::UV(), position, size, rotate, color, yRot);
+	}
+	// Queues a quad whose transform was already computed (see CommandList); depth is the window depth
+	void DrawAffine(GLenum target, GLuint texture, GLuint layer, glm::vec4 uvRect, const SpriteAffine &affine, glm::vec3 color, GLfloat depth = 0.0f)
+	{
+		if (!this->queue(target, texture, layer, uvRect, glm::vec2(0.0f), glm::vec2(0.0f), 0.0f, color, 0.0f))
+			return;
+		this->depths.back() = depth;
+		this->presetIndices.push_back((GLuint)(this->positionX.size() - 1));
+		this->presetAffines.push_back(affine);
+	}
+	// Submits the sprites queued so far, e.g. before changing GL state between them
+	void Flush()
+	{
+		this->flush();
+	}
+	// Sets the alpha below which fragments are discarded (0 keeps all) in all programs
+	void SetAlphaCutoff(GLfloat cutoff)
+	{
+		if (cutoff == this->alphaCutoff)
+			return;
+		this->flush();
+		this->alphaCutoff = cutoff;
+		this->shader.SetFloat(this->shader.GetUniform("alphaCutoff"), cutoff, GL_TRUE);
+		if (this->arrayShader.ID)
+			this->arrayShader.SetFloat(this->arrayShader.GetUniform("alphaCutoff"), cutoff, GL_TRUE);
+		if (this->shapeShader.ID)
+			this->shapeShader.SetFloat(this->shapeShader.GetUniform("alphaCutoff"), cutoff, GL_TRUE);
+	}
+	// Submits all queued sprites
+	void End()
+	{
+		this->flush();
+		this->drawing = GL_FALSE;
+		this->DrawCalls = this->frameDrawCalls;
+		this->SpriteCount = this->frameSprites;
+		this->stream.EndFrame();
+	}
+	// Vertex stream, exposes how long the batch waited on GPU fences
+	const StreamBuffer &GetStreamBuffer() const
+	{
+		return this->stream;
+	}
+private:
+	// Interleaved vertex layout: position, texture coordinates, color, array layer (packed kind and
+	// parameter for shapes), window depth
+	struct Vertex
+	{
+		GLfloat X, Y, U, V;
+		GLfloat R, G, B;
+		GLfloat Layer, Depth;
+	};
+	// Bytes streamed per frame before the ring moves on to the next region (room for four full flushes)
+	static const GLsizeiptr StreamRegionSize = MaxSprites * 4 * sizeof(Vertex) * 4;
+	// Render state
+	StreamBuffer stream;
+	Shader shader;
+	Shader arrayShader;
+	Shader shapeShader;
+	GLuint VAO, EBO;
+	GLuint currentTexture;
+	GLenum currentTarget;
+	GLboolean drawing;
+	GLuint frameDrawCalls, frameSprites;
+	GLfloat alphaCutoff;
+	// Queued sprites (structure of arrays) and their transformed quads
+	std::vector<GLfloat> positionX, positionY, sizeX, sizeY, rotation, pivotY;
+	std::vector<glm::vec3> colors;
+	std::vector<glm::vec4> uvs;
+	std::vector<GLfloat> layers, depths;
+	std::vector<SpriteAffine> affines;
+	// Sprites queued with DrawAffine and their transforms
+	std::vector<GLuint> presetIndices;
+	std::vector<SpriteAffine> presetAffines;
+	// Queues a sprite; uvRect selects the part of the texture (offset, extent)
+	bool queue(GLenum target, GLuint texture, GLuint layer, glm::vec4 uvRect, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot)
+	{
+		if (!this->drawing)
+		{
+			std::cout << "ERROR::SPRITEBATCH: DrawSprite called outside of Begin/End" << std::endl;
+			return false;
+		}
+		if (texture != this->currentTexture || target != this->currentTarget || this->positionX.size() >= MaxSprites)
+		{
+			this->flush();
+			this->currentTexture = texture;
+			this->currentTarget = target;
+		}
+		this->positionX.push_back(position.x);
+		this->positionY.push_back(position.y);
+		this->sizeX.push_back(size.x);
+		this->sizeY.push_back(size.y);
+		this->rotation.push_back(rotate);
+		this->pivotY.push_back(yRot);
+		this->colors.push_back(color);
+		this->uvs.push_back(uvRect);
+		this->layers.push_back((GLfloat)layer);
+		this->depths.push_back(0.0f);
+		this->frameSprites++;
+		return true;
+	}
+	void reserve(size_t count)
+	{
+		this->positionX.reserve(count);
+		this->positionY.reserve(count);
+		this->sizeX.reserve(count);
+		this->sizeY.reserve(count);
+		this->rotation.reserve(count);
+		this->pivotY.reserve(count);
+		this->colors.reserve(count);
+		this->uvs.reserve(count);
+		this->layers.reserve(count);
+		this->depths.reserve(count);
+		this->affines.resize(count);
+	}
+	void clear()
+	{
+		this->positionX.clear();
+		this->positionY.clear();
+		this->sizeX.clear();
+		this->sizeY.clear();
+		this->rotation.clear();
+		this->pivotY.clear();
+		this->colors.clear();
+		this->uvs.clear();
+		this->layers.clear();
+		this->depths.clear();
+		this->presetIndices.clear();
+		this->presetAffines.clear();
+	}
+	// Transforms the queued sprites into quad vertices, written sequentially to out
+	void buildVertices(size_t count, Vertex *out)
+	{
+		SpriteTransformInput in = { &this->positionX[0], &this->positionY[0], &this->sizeX[0], &this->sizeY[0], &this->rotation[0], &this->pivotY[0] };
+		SpriteTransform::ComputeAffines(in, count, &this->affines[0]);
+		for (size_t i = 0; i < this->presetIndices.size(); ++i)
+			this->affines[this->presetIndices[i]] = this->presetAffines[i];
+		const GLfloat corners[4][2] = { { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+		for (size_t i = 0; i < count; ++i)
+		{
+			const SpriteAffine &affine = this->affines[i];
+			const glm::vec3 &color = this->colors[i];
+			const glm::vec4 &uv = this->uvs[i];
+			Vertex *quad = out + i * 4;
+			for (int j = 0; j < 4; ++j)
+			{
+				glm::vec2 p = SpriteTransform::Apply(affine, corners[j][0], corners[j][1]);
+				quad[j].X = p.x;
+				quad[j].Y = p.y;
+				quad[j].U = uv.x + corners[j][0] * uv.z;
+				quad[j].V = uv.y + corners[j][1] * uv.w;
+				quad[j].R = color.r;
+				quad[j].G = color.g;
+				quad[j].B = color.b;
+				quad[j].Layer = this->layers[i];
+				quad[j].Depth = this->depths[i];
+			}
+		}
+	}
+	// Uploads and draws the queued vertices with the current texture
+	void flush()
+	{
+		size_t count = this->positionX.size();
+		if (count == 0)
+			return;
+		Shader &program = this->currentTarget == GL_TEXTURE_2D_ARRAY ? this->arrayShader
+			: this->currentTarget == SpriteShape::Target ? this->shapeShader : this->shader;
+		if (!program.Ready())
+		{
+			this->SkippedSprites += (GLuint)count;
+			this->clear();
+			return;
+		}
+		program.Use();
+		if (this->currentTarget != SpriteShape::Target)
+		{
+			GLState::ActiveTexture(GL_TEXTURE0);
+			GLState::BindTexture(this->currentTarget, this->currentTexture);
+		}
+
+		GLState::BindVertexArray(this->VAO);
+		GLState::BindBuffer(GL_ARRAY_BUFFER, this->stream.ID);
+		GLintptr offset;
+		Vertex *out = (Vertex*)this->stream.Map(count * 4 * sizeof(Vertex), sizeof(Vertex), &offset);
+		if (out != nullptr)
+		{
+			this->buildVertices(count, out);
+			this->stream.Unmap();
+			// The attribute pointers start at the beginning of the buffer, so offset the quads by a base vertex
+			glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(count * 6), GL_UNSIGNED_SHORT, 0, (GLint)(offset / sizeof(Vertex)));
+		}
+
+		this->frameDrawCalls++;
+		this->clear();
+	}
+	// Initializes the vertex layout over the stream buffer and the static quad index buffer
+	void initRenderData()
+	{
+		std::vector<GLushort> indices(MaxSprites * 6);
+		for (GLuint i = 0; i < MaxSprites; ++i)
+		{
+			GLushort base = (GLushort)(i * 4);
+			indices[i * 6 + 0] = base + 0;
+			indices[i * 6 + 1] = base + 1;
+			indices[i * 6 + 2] = base + 2;
+			indices[i * 6 + 3] = base + 0;
+			indices[i * 6 + 4] = base + 2;
+			indices[i * 6 + 5] = base + 3;
+		}
+
+		glGenVertexArrays(1, &this->VAO);
+		glGenBuffers(1, &this->EBO);
+
+		GLState::BindVertexArray(this->VAO);
+		GLState::BindBuffer(GL_ARRAY_BUFFER, this->stream.ID);
+		GLState::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), &indices[0], GL_STATIC_DRAW);
+
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)0);
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(4 * sizeof(GLfloat)));
+		glEnableVertexAttribArray(2);
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (GLvoid*)(7 * sizeof(GLfloat)));
+		GLState::BindVertexArray(0);
+		GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+};
+
+#endif
@@ -4,8 +4,11 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <common/GpuProfiler.h>
 #include <common/Texture.h>
 #include <common/Shader.h>
+#include <common/SpriteTransform.h>
+#include <common/TextureAtlas.h>
 
 class SpriteRenderer
 {
@@ -14,48 +17,64 @@ public:
 	SpriteRenderer(Shader &shader)
 	{
 		this->shader = shader;
+		this->initUniforms();
 		this->initRenderData();
 	}
 	// Destructor
 	~SpriteRenderer()
 	{
 		glDeleteVertexArrays(1, &this->quadVAO);
+		GLState::ForgetVertexArray(this->quadVAO);
+		glDeleteBuffers(1, &this->quadVBO);
+		GLState::ForgetBuffer(this->quadVBO);
 	}
 	// Renders a defined quad textured with given sprite
 	void DrawSprite(Texture2D &texture, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
 	{
-		// Prepare transformations
+		this->draw(texture.ID, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), position, size, rotate, color, yRot);
+	}
+	// Renders a defined quad textured with a sub-rectangle of an atlas page
+	void DrawSprite(const AtlasRegion &region, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot = 0.5f)
+	{
+		this->draw(region.TextureID, region.UV, position, size, rotate, color, yRot);
+	}
+private:
+	// Render state
+	Shader shader;
+	GLuint quadVAO;
+	GLuint quadVBO;
+	UniformHandle modelUniform, colorUniform, uvRectUniform;
+	// Draws the unit quad with the given texture, uvRect selects the part of the texture (offset, extent)
+	void draw(GLuint texture, glm::vec4 uvRect, glm::vec2 position, glm::vec2 size, GLfloat rotate, glm::vec3 color, GLfloat yRot)
+	{
+		GpuScope scope("sprite_renderer");
+		// Prepare transformations (scale, rotate around (0.5, yRot) of the quad, then translate)
 		this->shader.Use();
-		glm::mat4 model;
-		model = glm::translate(model, glm::vec3(position, 0.0f));  // First translate (transformations are: scale happens first, then rotation and then finall translation happens; reversed order)
-
-		model = glm::translate(model, glm::vec3(0.5f * size.x, yRot * size.y, 0.0f)); // Move origin of rotation to center of quad
-		model = glm::rotate(model, rotate, glm::vec3(0.0f, 0.0f, 1.0f)); // Then rotate
-		model = glm::translate(model, glm::vec3(-0.5f * size.x, -yRot * size.y, 0.0f)); // Move origin back
+		glm::mat4 model = SpriteTransform::ToMat4(SpriteTransform::Compose(position, size, rotate, yRot));
 
-		model = glm::scale(model, glm::vec3(size, 1.0f)); // Last scale
-
-		this->shader.SetMatrix4("model", model);
+		this->shader.SetMatrix4(this->modelUniform, model);
 
 		// Render textured quad
-		this->shader.SetVector3f("spriteColor", color);
+		this->shader.SetVector3f(this->colorUniform, color);
+		this->shader.SetVector4f(this->uvRectUniform, uvRect);
 
-		glActiveTexture(GL_TEXTURE0);
-		texture.Bind();
+		GLState::ActiveTexture(GL_TEXTURE0);
+		GLState::BindTexture(GL_TEXTURE_2D, texture);
 
-		glBindVertexArray(this->quadVAO);
+		GLState::BindVertexArray(this->quadVAO);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
-		glBindVertexArray(0);
 	}
-private:
-	// Render state
-	Shader shader;
-	GLuint quadVAO;
+	// Looks up the per-sprite uniforms once
+	void initUniforms()
+	{
+		this->modelUniform = this->shader.GetUniform("model");
+		this->colorUniform = this->shader.GetUniform("spriteColor");
+		this->uvRectUniform = this->shader.GetUniform("uvRect");
+	}
 	// Initializes and configures the quad's buffer and vertex attributes
 	void initRenderData()
 	{
 		// Configure VAO/VBO
-		GLuint VBO;
 		GLfloat vertices[] = {
 			// Pos      // Tex
 			0.0f, 1.0f, 0.0f, 1.0f,
@@ -68,16 +87,17 @@ private:
 		};
 
 		glGenVertexArrays(1, &this->quadVAO);
-		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &this->quadVBO);
 
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		GLState::BindBuffer(GL_ARRAY_BUFFER, this->quadVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
-		glBindVertexArray(this->quadVAO);
+		GLState::BindVertexArray(this->quadVAO);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (GLvoid*)0);
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
+
+		GLState::BindBuffer(GL_ARRAY_BUFFER, 0);
+		GLState::BindVertexArray(0);
 	}
 };
 
@@ -0,0 +1,43 @@
+#ifndef SPRITE_SHAPE_H
+#define SPRITE_SHAPE_H
+
+#include <glm/glm.hpp>
+
+#include <common/GLState.h>
+
+// Kinds of shape the SDF sprite program draws
+enum SpriteShapeKind
+{
+	ShapeCircle, // filled disc; Param darkens it towards the rim (0 is flat)
+	ShapeRing,   // outline; Param is its width
+	ShapeGlow    // soft disc, full up to Param then fading to nothing at the edge
+};
+
+// A circle, ring or glow inscribed in the sprite quad, evaluated as a
+// signed distance in the fragment shader instead of sampled from a
+// texture, so its edge stays one pixel wide at any size. Param is a
+// fraction of the radius. Edges are blended, so in a RenderQueue shapes
+// belong to the translucent (or cutout) material. Shapes share draw
+// calls regardless of kind: kind and parameter travel in the vertex
+// layer field, and Target stands in for a texture target that selects
+// the shape program.
+struct SpriteShape
+{
+	// Pseudo texture target of shapes in SpriteBatch, CommandList and RenderQueue
+	static const GLenum Target = GL_NONE;
+	SpriteShapeKind Kind;
+	GLfloat Param;
+	SpriteShape(SpriteShapeKind kind, GLfloat param = 0.0f) : Kind(kind), Param(param) { }
+	// Kind in the high bits, Param as 16 bit fixed point; exact as a float vertex attribute
+	GLuint Packed() const
+	{
+		return (GLuint)this->Kind << 16 | (GLuint)(glm::clamp(this->Param, 0.0f, 1.0f) * 65535.0f + 0.5f);
+	}
+	// Quad coordinates from -1 to 1, the shape's unit circle touching the quad edges
+	static glm::vec4 UV()
+	{
+		return glm::vec4(-1.0f, -1.0f, 2.0f, 2.0f);
+	}
+};
+
+#endif
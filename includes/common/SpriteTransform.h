@@ -0,0 +1,256 @@
+#ifndef SPRITE_TRANSFORM_H
+#define SPRITE_TRANSFORM_H
+
+#include <cmath>
+#include <cstddef>
+
+#include <glm/glm.hpp>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPRITE_TRANSFORM_SSE2 1
+#endif
+
+// Packed 2x3 affine transform of a sprite's unit quad:
+//   x' = A * x + C * y + Tx
+//   y' = B * x + D * y + Ty
+// Equivalent to the model matrix SpriteRenderer used to build with
+// translate/rotate/translate/scale, minus the unused z row and column.
+struct SpriteAffine
+{
+	float A, B, C, D, Tx, Ty;
+};
+
+// Structure-of-arrays view of the sprite parameters consumed by
+// SpriteTransform::ComputeAffines. All arrays hold the same count.
+struct SpriteTransformInput
+{
+	const float *PositionX, *PositionY;
+	const float *SizeX, *SizeY;
+	const float *Rotate;
+	const float *PivotY; // the yRot parameter of DrawSprite
+};
+
+// Builds sprite transforms as 2x3 affines instead of chained 4x4
+// glm matrices. ComputeAffines processes whole arrays with AVX2 or
+// SSE2 when the compiler targets them (-mavx2 / x86-64 default) and
+// falls back to scalar code otherwise. All functions are static.
+class SpriteTransform
+{
+public:
+	// Builds the affine of a single sprite
+	static SpriteAffine Compose(glm::vec2 position, glm::vec2 size, float rotate, float yRot = 0.5f)
+	{
+		return compose(position.x, position.y, size.x, size.y, std::cos(rotate), std::sin(rotate), yRot);
+	}
+	// Expands an affine to the model matrix expected by the sprite shaders
+	static glm::mat4 ToMat4(const SpriteAffine &affine)
+	{
+		glm::mat4 model;
+		model[0] = glm::vec4(affine.A, affine.B, 0.0f, 0.0f);
+		model[1] = glm::vec4(affine.C, affine.D, 0.0f, 0.0f);
+		model[3] = glm::vec4(affine.Tx, affine.Ty, 0.0f, 1.0f);
+		return model;
+	}
+	// Transforms a point of the unit quad
+	static glm::vec2 Apply(const SpriteAffine &affine, float x, float y)
+	{
+		return glm::vec2(affine.A * x + affine.C * y + affine.Tx, affine.B * x + affine.D * y + affine.Ty);
+	}
+	// Computes count affines from the SoA input using the widest available kernel
+	static void ComputeAffines(const SpriteTransformInput &in, size_t count, SpriteAffine *out)
+	{
+		size_t i = 0;
+#if defined(__AVX2__)
+		i = computeAVX2(in, count, out);
+#elif defined(SPRITE_TRANSFORM_SSE2)
+		i = computeSSE2(in, count, out);
+#endif
+		computeScalar(in, i, count, out);
+	}
+	// Scalar reference implementation, also used for the tail of the SIMD kernels
+	static void ComputeAffinesScalar(const SpriteTransformInput &in, size_t count, SpriteAffine *out)
+	{
+		computeScalar(in, 0, count, out);
+	}
+	// Name of the kernel selected at compile time
+	static const char *KernelName()
+	{
+#if defined(__AVX2__)
+		return "AVX2";
+#elif defined(SPRITE_TRANSFORM_SSE2)
+		return "SSE2";
+#else
+		return "scalar";
+#endif
+	}
+private:
+	SpriteTransform() { }
+	// Rotation about (0.5 * size.x, yRot * size.y), applied after scaling and before translating
+	static SpriteAffine compose(float px, float py, float sx, float sy, float c, float s, float yRot)
+	{
+		float pivotX = 0.5f * sx;
+		float pivotY = yRot * sy;
+		SpriteAffine affine;
+		affine.A = c * sx;
+		affine.B = s * sx;
+		affine.C = -s * sy;
+		affine.D = c * sy;
+		affine.Tx = px + pivotX - (c * pivotX - s * pivotY);
+		affine.Ty = py + pivotY - (s * pivotX + c * pivotY);
+		return affine;
+	}
+	static void computeScalar(const SpriteTransformInput &in, size_t begin, size_t end, SpriteAffine *out)
+	{
+		for (size_t i = begin; i < end; ++i)
+			out[i] = compose(in.PositionX[i], in.PositionY[i], in.SizeX[i], in.SizeY[i], std::cos(in.Rotate[i]), std::sin(in.Rotate[i]), in.PivotY[i]);
+	}
+#if defined(SPRITE_TRANSFORM_SSE2)
+	// sin/cos of four floats at once (Cephes range reduction and minimax polynomials)
+	static void sincosSSE2(__m128 x, __m128 *s, __m128 *c)
+	{
+		const __m128 signMask = _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000));
+		__m128 signSin = _mm_and_ps(x, signMask);
+		x = _mm_andnot_ps(signMask, x);
+
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(1.27323954473516f))); // 4 / pi
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		__m128 y = _mm_cvtepi32_ps(j);
+
+		__m128 swapSin = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29));
+		__m128 polyMask = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_setzero_si128()));
+		__m128 signCos = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		signSin = _mm_xor_ps(signSin, swapSin);
+
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-0.78515625f)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-2.4187564849853515625e-4f)));
+		x = _mm_add_ps(x, _mm_mul_ps(y, _mm_set1_ps(-3.77489497744594108e-8f)));
+		__m128 z = _mm_mul_ps(x, x);
+
+		__m128 cosPoly = _mm_set1_ps(2.443315711809948e-5f);
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(-1.388731625493765e-3f));
+		cosPoly = _mm_add_ps(_mm_mul_ps(cosPoly, z), _mm_set1_ps(4.166664568298827e-2f));
+		cosPoly = _mm_mul_ps(_mm_mul_ps(cosPoly, z), z);
+		cosPoly = _mm_sub_ps(cosPoly, _mm_mul_ps(z, _mm_set1_ps(0.5f)));
+		cosPoly = _mm_add_ps(cosPoly, _mm_set1_ps(1.0f));
+
+		__m128 sinPoly = _mm_set1_ps(-1.9515295891e-4f);
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(8.3321608736e-3f));
+		sinPoly = _mm_add_ps(_mm_mul_ps(sinPoly, z), _mm_set1_ps(-1.6666654611e-1f));
+		sinPoly = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sinPoly, z), x), x);
+
+		__m128 ySin = _mm_or_ps(_mm_and_ps(polyMask, sinPoly), _mm_andnot_ps(polyMask, cosPoly));
+		__m128 yCos = _mm_or_ps(_mm_and_ps(polyMask, cosPoly), _mm_andnot_ps(polyMask, sinPoly));
+		*s = _mm_xor_ps(ySin, signSin);
+		*c = _mm_xor_ps(yCos, signCos);
+	}
+	static size_t computeSSE2(const SpriteTransformInput &in, size_t count, SpriteAffine *out)
+	{
+		const __m128 half = _mm_set1_ps(0.5f);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128 s, c;
+			sincosSSE2(_mm_loadu_ps(in.Rotate + i), &s, &c);
+			__m128 sx = _mm_loadu_ps(in.SizeX + i);
+			__m128 sy = _mm_loadu_ps(in.SizeY + i);
+			__m128 pivotX = _mm_mul_ps(half, sx);
+			__m128 pivotY = _mm_mul_ps(_mm_loadu_ps(in.PivotY + i), sy);
+
+			float lanes[6][4];
+			_mm_storeu_ps(lanes[0], _mm_mul_ps(c, sx));
+			_mm_storeu_ps(lanes[1], _mm_mul_ps(s, sx));
+			_mm_storeu_ps(lanes[2], _mm_sub_ps(_mm_setzero_ps(), _mm_mul_ps(s, sy)));
+			_mm_storeu_ps(lanes[3], _mm_mul_ps(c, sy));
+			__m128 rx = _mm_sub_ps(_mm_mul_ps(c, pivotX), _mm_mul_ps(s, pivotY));
+			__m128 ry = _mm_add_ps(_mm_mul_ps(s, pivotX), _mm_mul_ps(c, pivotY));
+			_mm_storeu_ps(lanes[4], _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(in.PositionX + i), pivotX), rx));
+			_mm_storeu_ps(lanes[5], _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(in.PositionY + i), pivotY), ry));
+			scatter(lanes[0], 4, out + i);
+		}
+		return i;
+	}
+#endif
+#if defined(__AVX2__)
+	// 8-wide variant of sincosSSE2
+	static void sincosAVX2(__m256 x, __m256 *s, __m256 *c)
+	{
+		const __m256 signMask = _mm256_castsi256_ps(_mm256_set1_epi32((int)0x80000000));
+		__m256 signSin = _mm256_and_ps(x, signMask);
+		x = _mm256_andnot_ps(signMask, x);
+
+		__m256i j = _mm256_cvttps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(1.27323954473516f)));
+		j = _mm256_and_si256(_mm256_add_epi32(j, _mm256_set1_epi32(1)), _mm256_set1_epi32(~1));
+		__m256 y = _mm256_cvtepi32_ps(j);
+
+		__m256 swapSin = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(j, _mm256_set1_epi32(4)), 29));
+		__m256 polyMask = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(j, _mm256_set1_epi32(2)), _mm256_setzero_si256()));
+		__m256 signCos = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_andnot_si256(_mm256_sub_epi32(j, _mm256_set1_epi32(2)), _mm256_set1_epi32(4)), 29));
+		signSin = _mm256_xor_ps(signSin, swapSin);
+
+		x = _mm256_fmadd_ps(y, _mm256_set1_ps(-0.78515625f), x);
+		x = _mm256_fmadd_ps(y, _mm256_set1_ps(-2.4187564849853515625e-4f), x);
+		x = _mm256_fmadd_ps(y, _mm256_set1_ps(-3.77489497744594108e-8f), x);
+		__m256 z = _mm256_mul_ps(x, x);
+
+		__m256 cosPoly = _mm256_set1_ps(2.443315711809948e-5f);
+		cosPoly = _mm256_fmadd_ps(cosPoly, z, _mm256_set1_ps(-1.388731625493765e-3f));
+		cosPoly = _mm256_fmadd_ps(cosPoly, z, _mm256_set1_ps(4.166664568298827e-2f));
+		cosPoly = _mm256_mul_ps(_mm256_mul_ps(cosPoly, z), z);
+		cosPoly = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), cosPoly);
+		cosPoly = _mm256_add_ps(cosPoly, _mm256_set1_ps(1.0f));
+
+		__m256 sinPoly = _mm256_set1_ps(-1.9515295891e-4f);
+		sinPoly = _mm256_fmadd_ps(sinPoly, z, _mm256_set1_ps(8.3321608736e-3f));
+		sinPoly = _mm256_fmadd_ps(sinPoly, z, _mm256_set1_ps(-1.6666654611e-1f));
+		sinPoly = _mm256_fmadd_ps(_mm256_mul_ps(sinPoly, z), x, x);
+
+		*s = _mm256_xor_ps(_mm256_blendv_ps(cosPoly, sinPoly, polyMask), signSin);
+		*c = _mm256_xor_ps(_mm256_blendv_ps(sinPoly, cosPoly, polyMask), signCos);
+	}
+	static size_t computeAVX2(const SpriteTransformInput &in, size_t count, SpriteAffine *out)
+	{
+		const __m256 half = _mm256_set1_ps(0.5f);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256 s, c;
+			sincosAVX2(_mm256_loadu_ps(in.Rotate + i), &s, &c);
+			__m256 sx = _mm256_loadu_ps(in.SizeX + i);
+			__m256 sy = _mm256_loadu_ps(in.SizeY + i);
+			__m256 pivotX = _mm256_mul_ps(half, sx);
+			__m256 pivotY = _mm256_mul_ps(_mm256_loadu_ps(in.PivotY + i), sy);
+
+			float lanes[6][8];
+			_mm256_storeu_ps(lanes[0], _mm256_mul_ps(c, sx));
+			_mm256_storeu_ps(lanes[1], _mm256_mul_ps(s, sx));
+			_mm256_storeu_ps(lanes[2], _mm256_sub_ps(_mm256_setzero_ps(), _mm256_mul_ps(s, sy)));
+			_mm256_storeu_ps(lanes[3], _mm256_mul_ps(c, sy));
+			__m256 rx = _mm256_fmsub_ps(c, pivotX, _mm256_mul_ps(s, pivotY));
+			__m256 ry = _mm256_fmadd_ps(s, pivotX, _mm256_mul_ps(c, pivotY));
+			_mm256_storeu_ps(lanes[4], _mm256_sub_ps(_mm256_add_ps(_mm256_loadu_ps(in.PositionX + i), pivotX), rx));
+			_mm256_storeu_ps(lanes[5], _mm256_sub_ps(_mm256_add_ps(_mm256_loadu_ps(in.PositionY + i), pivotY), ry));
+			scatter(lanes[0], 8, out + i);
+		}
+		return i;
+	}
+#endif
+	// Transposes six rows of width lanes into width consecutive SpriteAffines
+	static void scatter(const float *rows, size_t width, SpriteAffine *out)
+	{
+		for (size_t lane = 0; lane < width; ++lane)
+		{
+			out[lane].A = rows[0 * width + lane];
+			out[lane].B = rows[1 * width + lane];
+			out[lane].C = rows[2 * width + lane];
+			out[lane].D = rows[3 * width + lane];
+			out[lane].Tx = rows[4 * width + lane];
+			out[lane].Ty = rows[5 * width + lane];
+		}
+	}
+};
+
+#endif
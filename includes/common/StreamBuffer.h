@@ -0,0 +1,151 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include <common/GLState.h>
+
+// StreamBuffer is a ring of per-frame regions inside one buffer object
+// used to stream dynamic vertex data (sprite batches, particles, text)
+// to the GPU without orphaning. Each region is fenced with glFenceSync
+// when its frame ends and only rewritten once that fence signalled, so
+// with enough regions for the frames in flight the CPU never waits.
+// With GL 4.4 (ARB_buffer_storage) the buffer is mapped once,
+// persistently and coherently; otherwise every allocation maps its
+// range with GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT,
+// which is safe because the fences already provide synchronization.
+class StreamBuffer
+{
+public:
+	// Buffer object and layout
+	GLuint ID;
+	GLenum Target;
+	GLsizeiptr RegionSize;
+	GLuint Regions;
+	GLboolean Persistent;
+	// Fence wait statistics: the last frame, and totals since creation
+	double LastWaitMilliseconds;
+	double TotalWaitMilliseconds;
+	GLuint Stalls; // number of region switches that had to wait for the GPU
+	GLuint Frames;
+	// Constructor (allocates regions * regionSize bytes)
+	StreamBuffer(GLenum target, GLsizeiptr regionSize, GLuint regions = 3)
+		: Target(target), RegionSize(regionSize), Regions(regions), Persistent(GL_FALSE),
+		  LastWaitMilliseconds(0.0), TotalWaitMilliseconds(0.0), Stalls(0), Frames(0),
+		  region(0), cursor(0), frameWait(0.0), mapped(nullptr), fences(regions, (GLsync)0)
+	{
+		glGenBuffers(1, &this->ID);
+		GLState::BindBuffer(this->Target, this->ID);
+		GLsizeiptr size = this->RegionSize * this->Regions;
+		if (GLAD_GL_VERSION_4_4 && glBufferStorage != NULL)
+		{
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(this->Target, size, NULL, flags);
+			this->mapped = (unsigned char*)glMapBufferRange(this->Target, 0, size, flags);
+			this->Persistent = this->mapped != nullptr;
+		}
+		if (!this->Persistent)
+			glBufferData(this->Target, size, NULL, GL_STREAM_DRAW);
+		GLState::BindBuffer(this->Target, 0);
+	}
+	StreamBuffer(const StreamBuffer&) = delete;
+	StreamBuffer &operator=(const StreamBuffer&) = delete;
+	// Destructor
+	~StreamBuffer()
+	{
+		for (GLuint i = 0; i < this->Regions; ++i)
+			if (this->fences[i])
+				glDeleteSync(this->fences[i]);
+		if (this->Persistent)
+		{
+			GLState::BindBuffer(this->Target, this->ID);
+			glUnmapBuffer(this->Target);
+			GLState::BindBuffer(this->Target, 0);
+		}
+		glDeleteBuffers(1, &this->ID);
+		GLState::ForgetBuffer(this->ID);
+	}
+	// Reserves bytes in the current region and returns a pointer to write them to. offset
+	// receives the byte offset within the buffer, a multiple of alignment. Call Unmap()
+	// once written. The buffer must be bound to Target.
+	void *Map(GLsizeiptr bytes, GLsizeiptr alignment, GLintptr *offset)
+	{
+		if (bytes > this->RegionSize)
+		{
+			std::cout << "ERROR::STREAMBUFFER: Allocation of " << bytes << " bytes exceeds the region size" << std::endl;
+			return nullptr;
+		}
+		GLintptr start = this->regionStart() + this->cursor;
+		start = (start + alignment - 1) / alignment * alignment;
+		if (start + bytes > this->regionStart() + this->RegionSize)
+		{
+			// Region exhausted: move on early as if the frame had ended
+			this->advance();
+			start = this->regionStart();
+			start = (start + alignment - 1) / alignment * alignment;
+		}
+		this->cursor = start + bytes - this->regionStart();
+		*offset = start;
+		if (this->Persistent)
+			return this->mapped + start;
+		return glMapBufferRange(this->Target, start, bytes, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+	}
+	// Finishes writing the range returned by Map()
+	void Unmap()
+	{
+		if (!this->Persistent)
+			glUnmapBuffer(this->Target);
+	}
+	// Fences the current region and switches to the next one
+	void EndFrame()
+	{
+		this->advance();
+		this->LastWaitMilliseconds = this->frameWait;
+		this->frameWait = 0.0;
+		this->Frames++;
+	}
+private:
+	GLuint region;
+	GLintptr cursor;
+	double frameWait;
+	unsigned char *mapped;
+	std::vector<GLsync> fences;
+	GLintptr regionStart() const
+	{
+		return this->region * this->RegionSize;
+	}
+	void advance()
+	{
+		if (this->fences[this->region])
+			glDeleteSync(this->fences[this->region]);
+		this->fences[this->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		this->region = (this->region + 1) % this->Regions;
+		this->cursor = 0;
+		this->waitForRegion();
+	}
+	// Blocks until the GPU finished reading the current region, measuring the time spent
+	void waitForRegion()
+	{
+		GLsync fence = this->fences[this->region];
+		if (!fence)
+			return;
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			do
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			while (result == GL_TIMEOUT_EXPIRED);
+			double waited = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			this->frameWait += waited;
+			this->TotalWaitMilliseconds += waited;
+			this->Stalls++;
+		}
+		glDeleteSync(fence);
+		this->fences[this->region] = (GLsync)0;
+	}
+};
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <common/GLState.h>
+#include <common/GpuProfiler.h>
+#include <common/Shader.h>
+#include <common/SdfFont.h>
+#include <common/StreamBuffer.h>
+
+// Glyph quads of a string, laid out once in font page texels from a
+// pen at the origin (top left of the first line)
+struct TextLayout
+{
+	std::vector<glm::vec4> Rects; // offset and extent of each visible glyph
+	std::vector<glm::vec4> UVs;
+	glm::vec2 Size;
+	TextLayout() : Size(0.0f) { }
+};
+
+// TextRenderer draws strings of an SdfFont as instanced glyph quads
+// (text.vs/.fs). Layouts are cached by string and do not depend on
+// position or size, so unchanged text is only laid out once. Every
+// string drawn between Begin() and End() is streamed into one buffer
+// and drawn with a single instanced call; the distance field keeps
+// glyph edges a pixel wide at any scale, so nothing is rasterized
+// again when the size changes. Draws with the current blend state.
+class TextRenderer
+{
+public:
+	// Glyphs submitted in one draw call at most
+	static const GLuint MaxGlyphs = 4096;
+	// Layouts kept before the cache is emptied, strings that change every frame would grow it forever
+	static const size_t MaxCachedLayouts = 256;
+	// Statistics of the last End(), and layout cache lookups since creation
+	GLuint DrawCalls, GlyphCount;
+	GLuint LayoutHits, LayoutMisses;
+	// Band around the glyphs in font page texels, up to half the font's distance range (0 draws none)
+	GLfloat Outline;
+	glm::vec4 OutlineColor;
+	// Constructor (shader is text.vs/.fs; font must outlive the renderer)
+	TextRenderer(Shader shader, const SdfFont &font)
+		: DrawCalls(0), GlyphCount(0), LayoutHits(0), LayoutMisses(0), Outline(0.0f), OutlineColor(0.0f, 0.0f, 0.0f, 1.0f),
+		  shader(shader), font(font), stream(GL_ARRAY_BUFFER, MaxGlyphs * sizeof(Instance) * 2), drawing(false)
+	{
+		this->instances.reserve(MaxGlyphs);
+		glGenVertexArrays(1, &this->VAO);
+	}
+	~TextRenderer()
+	{
+		glDeleteVertexArrays(1, &this->VAO);
+		GLState::ForgetVertexArray(this->VAO);
+	}
+	// Layout of text, from the cache when it was laid out before
+	const TextLayout &Layout(const std::string &text)
+	{
+		std::map<std::string, TextLayout>::iterator it = this->layouts.find(text);
+		if (it != this->layouts.end())
+		{
+			this->LayoutHits++;
+			return it->second;
+		}
+		this->LayoutMisses++;
+		if (this->layouts.size() >= MaxCachedLayouts)
+			this->layouts.clear();
+		TextLayout &layout = this->layouts[text];
+		GLfloat penX = 0.0f, penY = 0.0f;
+		for (size_t i = 0; i < text.size(); ++i)
+		{
+			if (text[i] == '\n')
+			{
+				penX = 0.0f;
+				penY += this->font.LineHeight;
+				continue;
+			}
+			const SdfGlyph *glyph = this->font.Find((unsigned char)text[i]);
+			if (glyph == nullptr)
+				glyph = this->font.Find('?');
+			if (glyph == nullptr)
+				continue;
+			if (glyph->Width > 0)
+			{
+				layout.Rects.push_back(glm::vec4(penX + glyph->BearingX, penY + glyph->BearingY, glyph->Width, glyph->Height));
+				layout.UVs.push_back(glyph->UV);
+			}
+			penX += glyph->Advance;
+			layout.Size.x = glm::max(layout.Size.x, penX);
+		}
+		layout.Size.y = penY + this->font.LineHeight;
+		return layout;
+	}
+	// Size of text drawn with lines height units high
+	glm::vec2 Measure(const std::string &text, GLfloat height)
+	{
+		return this->Layout(text).Size * (height / this->font.LineHeight);
+	}
+	// Starts collecting text
+	void Begin()
+	{
+		this->drawing = true;
+		this->frameDrawCalls = 0;
+		this->frameGlyphs = 0;
+		this->instances.clear();
+	}
+	// Queues text with its top left at position, lines height units high
+	void Draw(const std::string &text, glm::vec2 position, GLfloat height, glm::vec4 color)
+	{
+		if (!this->drawing)
+		{
+			std::cout << "ERROR::TEXTRENDERER: Draw called outside of Begin/End" << std::endl;
+			return;
+		}
+		const TextLayout &layout = this->Layout(text);
+		GLfloat scale = height / this->font.LineHeight;
+		GLuint packed = packColor(color);
+		for (size_t i = 0; i < layout.Rects.size(); ++i)
+		{
+			if (this->instances.size() >= MaxGlyphs)
+				this->flush();
+			const glm::vec4 &rect = layout.Rects[i];
+			Instance instance;
+			instance.Rect = glm::vec4(position + glm::vec2(rect.x, rect.y) * scale, glm::vec2(rect.z, rect.w) * scale);
+			instance.UV = layout.UVs[i];
+			instance.Color = packed;
+			this->instances.push_back(instance);
+		}
+	}
+	// Draws all queued text
+	void End()
+	{
+		this->flush();
+		this->drawing = false;
+		this->DrawCalls = this->frameDrawCalls;
+		this->GlyphCount = this->frameGlyphs;
+		this->stream.EndFrame();
+	}
+private:
+	// Per glyph instance: rectangle (offset, extent), page coordinates, RGBA8 color
+	struct Instance
+	{
+		glm::vec4 Rect;
+		glm::vec4 UV;
+		GLuint Color;
+	};
+	Shader shader;
+	const SdfFont &font;
+	StreamBuffer stream;
+	GLuint VAO;
+	bool drawing;
+	GLuint frameDrawCalls, frameGlyphs;
+	std::vector<Instance> instances;
+	std::map<std::string, TextLayout> layouts;
+	void flush()
+	{
+		GLuint count = (GLuint)this->instances.size();
+		if (count == 0 || !this->shader.Ready())
+		{
+			this->instances.clear();
+			return;
+		}
+		GpuScope scope("text");
+		this->shader.Use();
+		this->shader.SetInteger("page", 0);
+		this->shader.SetFloat("distanceRange", this->font.DistanceRange);
+		this->shader.SetFloat("outline", this->Outline / this->font.DistanceRange);
+		this->shader.SetVector4f("outlineColor", this->OutlineColor);
+		GLState::ActiveTexture(GL_TEXTURE0);
+		GLState::BindTexture(GL_TEXTURE_2D, this->font.Page.ID);
+		GLState::BindVertexArray(this->VAO);
+		GLState::BindBuffer(GL_ARRAY_BUFFER, this->stream.ID);
+		GLintptr offset;
+		void *out = this->stream.Map(count * sizeof(Instance), sizeof(Instance), &offset);
+		if (out != nullptr)
+		{
+			std::memcpy(out, &this->instances[0], count * sizeof(Instance));
+			this->stream.Unmap();
+			// GL 3.3 has no base instance, the attributes point at this draw's instances instead
+			glEnableVertexAttribArray(0);
+			glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (GLvoid*)(offset + offsetof(Instance, Rect)));
+			glVertexAttribDivisor(0, 1);
+			glEnableVertexAttribArray(1);
+			glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(Instance), (GLvoid*)(offset + offsetof(Instance, UV)));
+			glVertexAttribDivisor(1, 1);
+			glEnableVertexAttribArray(2);
+			glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Instance), (GLvoid*)(offset + offsetof(Instance, Color)));
+			glVertexAttribDivisor(2, 1);
+			glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+			this->frameDrawCalls++;
+			this->frameGlyphs += count;
+		}
+		this->instances.clear();
+	}
+	static GLuint packColor(glm::vec4 color)
+	{
+		glm::uvec4 c = glm::uvec4(glm::clamp(color, 0.0f, 1.0f) * 255.0f + 0.5f);
+		return c.r | c.g << 8 | c.b << 16 | c.a << 24;
+	}
+};
+
+#endif
@@ -1,6 +1,8 @@
 #ifndef TEXTURE_H
 #define TEXTURE_H
 
+#include <common/GLState.h>
+
 // Texture2D is able to store and configure a texture in OpenGL.
 // It also hosts utility functions for easy management.
 class Texture2D
@@ -32,7 +34,7 @@ public:
 		this->Height = height;
 		this->Path = (const char*) data;
 		// Create Texture
-		glBindTexture(GL_TEXTURE_2D, this->ID);
+		GLState::BindTexture(GL_TEXTURE_2D, this->ID);
 		glTexImage2D(GL_TEXTURE_2D, 0, this->Internal_Format, width, height, 0, this->Image_Format, GL_UNSIGNED_BYTE, data);
 		glGenerateMipmap(GL_TEXTURE_2D);
 		// Set Texture wrap and filter modes
@@ -41,12 +43,19 @@ public:
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, this->Filter_Min);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, this->Filter_Max);
 		// Unbind texture
-		glBindTexture(GL_TEXTURE_2D, 0);
+		GLState::BindTexture(GL_TEXTURE_2D, 0);
 	}
 	// Binds the texture as the current active GL_TEXTURE_2D texture object
 	void Bind() const
 	{
-		glBindTexture(GL_TEXTURE_2D, this->ID);
+		GLState::BindTexture(GL_TEXTURE_2D, this->ID);
+	}
+	// Deletes the texture object; copies of this Texture2D must not be used afterwards
+	void Delete()
+	{
+		glDeleteTextures(1, &this->ID);
+		GLState::ForgetTexture(this->ID);
+		this->ID = 0;
 	}
 };
 
@@ -0,0 +1,76 @@
+#ifndef TEXTURE_ARRAY_H
+#define TEXTURE_ARRAY_H
+
+#include <vector>
+
+#include <common/GLState.h>
+
+// Handle to one image stored as a layer of a TextureArray
+struct TextureLayer
+{
+	GLuint ArrayID; // texture object of the GL_TEXTURE_2D_ARRAY
+	GLuint Layer;
+	GLuint Width, Height;
+	TextureLayer() : ArrayID(0), Layer(0), Width(0), Height(0) { }
+};
+
+// TextureArray stores equally sized images of the same format as the
+// layers of a single GL_TEXTURE_2D_ARRAY, so switching between them is
+// a layer index change instead of a texture rebind. Configuration
+// mirrors Texture2D.
+class TextureArray
+{
+public:
+	// Holds the ID of the texture object
+	GLuint ID;
+	// Layer dimensions and layer count
+	GLuint Width, Height, Layers;
+	// Texture Format
+	GLuint Internal_Format; // Format of texture object
+	GLuint Image_Format; // Format of loaded images
+	// Texture configuration
+	GLuint Wrap_S; // Wrapping mode on S axis
+	GLuint Wrap_T; // Wrapping mode on T axis
+	GLuint Filter_Min; // Filtering mode if texture pixels < screen pixels
+	GLuint Filter_Max; // Filtering mode if texture pixels > screen pixels
+	// Constructor (sets default texture modes)
+	TextureArray()
+		: Width(0), Height(0), Layers(0), Internal_Format(GL_RGB), Image_Format(GL_RGB), Wrap_S(GL_REPEAT), Wrap_T(GL_REPEAT), Filter_Min(GL_LINEAR), Filter_Max(GL_LINEAR)
+	{
+		glGenTextures(1, &this->ID);
+	}
+	// Generates the array from one image per layer, all width x height in Image_Format
+	void Generate(GLuint width, GLuint height, const std::vector<unsigned char*> &layers)
+	{
+		this->Width = width;
+		this->Height = height;
+		this->Layers = (GLuint)layers.size();
+		// Create Texture
+		GLState::BindTexture(GL_TEXTURE_2D_ARRAY, this->ID);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, this->Internal_Format, width, height, this->Layers, 0, this->Image_Format, GL_UNSIGNED_BYTE, NULL);
+		for (GLuint i = 0; i < this->Layers; ++i)
+			glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, this->Image_Format, GL_UNSIGNED_BYTE, layers[i]);
+		glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		// Set Texture wrap and filter modes
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, this->Wrap_S);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, this->Wrap_T);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, this->Filter_Min);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, this->Filter_Max);
+		// Unbind texture
+		GLState::BindTexture(GL_TEXTURE_2D_ARRAY, 0);
+	}
+	// Binds the texture as the current active GL_TEXTURE_2D_ARRAY texture object
+	void Bind() const
+	{
+		GLState::BindTexture(GL_TEXTURE_2D_ARRAY, this->ID);
+	}
+	// Deletes the texture object; copies of this TextureArray must not be used afterwards
+	void Delete()
+	{
+		glDeleteTextures(1, &this->ID);
+		GLState::ForgetTexture(this->ID);
+		this->ID = 0;
+	}
+};
+
+#endif
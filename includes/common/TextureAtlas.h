@@ -0,0 +1,436 @@
+#ifndef TEXTURE_ATLAS_H
+#define TEXTURE_ATLAS_H
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include <common/Texture.h>
+
+#include <SOIL.h>
+
+// A named sub-rectangle of an atlas page. UV holds the normalized
+// offset (xy) and extent (zw) of the region within its page so it
+// can be drawn with SpriteRenderer/SpriteBatch like a whole texture.
+struct AtlasRegion
+{
+	GLuint TextureID; // texture object of the page this region lives in
+	GLuint Page;
+	GLuint X, Y, Width, Height; // in pixels, without padding
+	glm::vec4 UV;
+	AtlasRegion() : TextureID(0), Page(0), X(0), Y(0), Width(0), Height(0), UV(0.0f, 0.0f, 1.0f, 1.0f) { }
+};
+
+// Skyline bottom-left rectangle packer for a single page. Each
+// placement picks the position whose top edge ends up lowest,
+// which keeps the skyline flat for the next rectangles.
+class SkylinePacker
+{
+public:
+	GLuint Width, Height;
+	SkylinePacker(GLuint width, GLuint height) : Width(width), Height(height)
+	{
+		Node node = { 0, 0, width };
+		this->skyline.push_back(node);
+	}
+	// Finds a spot for a width x height rectangle; returns false if the page is full
+	bool Insert(GLuint width, GLuint height, GLuint *x, GLuint *y)
+	{
+		size_t bestIndex = this->skyline.size();
+		GLuint bestTop = 0xFFFFFFFF, bestWidth = 0xFFFFFFFF;
+		for (size_t i = 0; i < this->skyline.size(); ++i)
+		{
+			GLuint top;
+			if (!this->fits(i, width, height, &top))
+				continue;
+			if (top < bestTop || (top == bestTop && this->skyline[i].Width < bestWidth))
+			{
+				bestIndex = i;
+				bestTop = top;
+				bestWidth = this->skyline[i].Width;
+			}
+		}
+		if (bestIndex == this->skyline.size())
+			return false;
+		*x = this->skyline[bestIndex].X;
+		*y = bestTop - height;
+		this->addLevel(bestIndex, *x, bestTop, width);
+		return true;
+	}
+private:
+	// A horizontal segment of the skyline: [X, X + Width) is filled up to Y
+	struct Node
+	{
+		GLuint X, Y, Width;
+	};
+	std::vector<Node> skyline;
+	// Checks whether the rectangle fits with its left edge on node index and returns its top edge
+	bool fits(size_t index, GLuint width, GLuint height, GLuint *top) const
+	{
+		GLuint x = this->skyline[index].X;
+		if (x + width > this->Width)
+			return false;
+		GLuint y = 0;
+		GLuint remaining = width;
+		for (size_t i = index; remaining > 0; ++i)
+		{
+			if (i == this->skyline.size())
+				return false;
+			y = std::max(y, this->skyline[i].Y);
+			if (y + height > this->Height)
+				return false;
+			remaining -= std::min(remaining, this->skyline[i].Width);
+		}
+		*top = y + height;
+		return true;
+	}
+	// Raises the skyline over [x, x + width) to top and merges equal neighbours
+	void addLevel(size_t index, GLuint x, GLuint top, GLuint width)
+	{
+		Node node = { x, top, width };
+		this->skyline.insert(this->skyline.begin() + index, node);
+		for (size_t i = index + 1; i < this->skyline.size(); )
+		{
+			Node &previous = this->skyline[i - 1];
+			Node &current = this->skyline[i];
+			if (current.X >= previous.X + previous.Width)
+				break;
+			GLuint shrink = previous.X + previous.Width - current.X;
+			if (shrink < current.Width)
+			{
+				current.X += shrink;
+				current.Width -= shrink;
+				break;
+			}
+			this->skyline.erase(this->skyline.begin() + i);
+		}
+		for (size_t i = 0; i + 1 < this->skyline.size(); )
+		{
+			if (this->skyline[i].Y == this->skyline[i + 1].Y)
+			{
+				this->skyline[i].Width += this->skyline[i + 1].Width;
+				this->skyline.erase(this->skyline.begin() + i + 1);
+			}
+			else
+				++i;
+		}
+	}
+};
+
+// Packs RGBA images into one or more atlas pages. Every image gets
+// Padding pixels on each side filled with its extruded border so
+// filtering and lower mip levels do not bleed neighbouring sprites
+// in. The result can be uploaded directly (TextureAtlas::Generate)
+// or written to disk (Save) and loaded later (TextureAtlas::Load),
+// which is what src/tools/atlas_packer does as an offline step.
+class TextureAtlasBuilder
+{
+public:
+	// Packed page pixel data (RGBA, PageWidth x PageHeight)
+	std::vector<std::vector<unsigned char> > Pages;
+	// Packed regions by name; TextureID is not set until uploaded
+	std::map<std::string, AtlasRegion> Regions;
+	GLuint PageWidth, PageHeight, Padding;
+	// Constructor
+	TextureAtlasBuilder(GLuint pageWidth = 1024, GLuint pageHeight = 1024, GLuint padding = 4)
+		: PageWidth(pageWidth), PageHeight(pageHeight), Padding(padding) { }
+	// Queues an image file for packing
+	bool AddFile(const std::string &name, const GLchar *file)
+	{
+		int width, height;
+		unsigned char *image = SOIL_load_image(file, &width, &height, 0, SOIL_LOAD_RGBA);
+		if (image == nullptr)
+		{
+			std::cout << "ERROR::ATLAS: Failed to load image " << file << std::endl;
+			return false;
+		}
+		this->AddImage(name, image, width, height);
+		SOIL_free_image_data(image);
+		return true;
+	}
+	// Queues RGBA pixel data for packing
+	void AddImage(const std::string &name, const unsigned char *pixels, GLuint width, GLuint height)
+	{
+		Image image;
+		image.Name = name;
+		image.Width = width;
+		image.Height = height;
+		image.Pixels.assign(pixels, pixels + width * height * 4);
+		this->images.push_back(image);
+	}
+	// Packs all queued images, tallest first; returns false if an image does not fit on a page
+	bool Build()
+	{
+		std::vector<Image*> order;
+		for (size_t i = 0; i < this->images.size(); ++i)
+			order.push_back(&this->images[i]);
+		std::sort(order.begin(), order.end(), tallerFirst);
+
+		bool success = true;
+		std::vector<SkylinePacker> packers;
+		for (size_t i = 0; i < order.size(); ++i)
+		{
+			Image &image = *order[i];
+			GLuint paddedWidth = image.Width + 2 * this->Padding;
+			GLuint paddedHeight = image.Height + 2 * this->Padding;
+			if (paddedWidth > this->PageWidth || paddedHeight > this->PageHeight)
+			{
+				std::cout << "ERROR::ATLAS: Image " << image.Name << " does not fit on a " << this->PageWidth << "x" << this->PageHeight << " page" << std::endl;
+				success = false;
+				continue;
+			}
+			GLuint x = 0, y = 0;
+			size_t page = 0;
+			while (page < packers.size() && !packers[page].Insert(paddedWidth, paddedHeight, &x, &y))
+				++page;
+			if (page == packers.size())
+			{
+				packers.push_back(SkylinePacker(this->PageWidth, this->PageHeight));
+				this->Pages.push_back(std::vector<unsigned char>(this->PageWidth * this->PageHeight * 4, 0));
+				packers[page].Insert(paddedWidth, paddedHeight, &x, &y);
+			}
+			this->blit(image, page, x, y);
+
+			AtlasRegion region;
+			region.Page = (GLuint)page;
+			region.X = x + this->Padding;
+			region.Y = y + this->Padding;
+			region.Width = image.Width;
+			region.Height = image.Height;
+			region.UV = regionUV(region, this->PageWidth, this->PageHeight);
+			this->Regions[image.Name] = region;
+		}
+		this->images.clear();
+		return success;
+	}
+	// Writes every page as <basename>_<page>.tga and the binary region index as <basename>.atlas
+	bool Save(const std::string &basename) const
+	{
+		std::vector<std::string> pageFiles;
+		for (size_t i = 0; i < this->Pages.size(); ++i)
+		{
+			std::string file = basename + "_" + std::to_string(i) + ".tga";
+			if (!SOIL_save_image(file.c_str(), SOIL_SAVE_TYPE_TGA, this->PageWidth, this->PageHeight, 4, &this->Pages[i][0]))
+			{
+				std::cout << "ERROR::ATLAS: Failed to write page " << file << std::endl;
+				return false;
+			}
+			// pages are referenced relative to the index file
+			pageFiles.push_back(file.substr(file.find_last_of("/\\") + 1));
+		}
+		std::string indexFile = basename + ".atlas";
+		FILE *index = std::fopen(indexFile.c_str(), "wb");
+		if (index == nullptr)
+		{
+			std::cout << "ERROR::ATLAS: Failed to write index " << indexFile << std::endl;
+			return false;
+		}
+		writeUint(index, IndexMagic);
+		writeUint(index, IndexVersion);
+		writeUint(index, this->PageWidth);
+		writeUint(index, this->PageHeight);
+		writeUint(index, (GLuint)pageFiles.size());
+		for (size_t i = 0; i < pageFiles.size(); ++i)
+			writeString(index, pageFiles[i]);
+		writeUint(index, (GLuint)this->Regions.size());
+		for (std::map<std::string, AtlasRegion>::const_iterator it = this->Regions.begin(); it != this->Regions.end(); ++it)
+		{
+			writeString(index, it->first);
+			writeUint(index, it->second.Page);
+			writeUint(index, it->second.X);
+			writeUint(index, it->second.Y);
+			writeUint(index, it->second.Width);
+			writeUint(index, it->second.Height);
+		}
+		std::fclose(index);
+		return true;
+	}
+	// Binary index layout: magic, version, page size, page file names, then named regions
+	static const GLuint IndexMagic = 0x54414853; // "SHAT"
+	static const GLuint IndexVersion = 1;
+	static glm::vec4 regionUV(const AtlasRegion &region, GLuint pageWidth, GLuint pageHeight)
+	{
+		return glm::vec4((GLfloat)region.X / pageWidth, (GLfloat)region.Y / pageHeight,
+			(GLfloat)region.Width / pageWidth, (GLfloat)region.Height / pageHeight);
+	}
+	static void writeUint(FILE *file, GLuint value)
+	{
+		unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8), (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+		std::fwrite(bytes, 1, 4, file);
+	}
+	static void writeString(FILE *file, const std::string &value)
+	{
+		writeUint(file, (GLuint)value.size());
+		std::fwrite(value.data(), 1, value.size(), file);
+	}
+private:
+	struct Image
+	{
+		std::string Name;
+		GLuint Width, Height;
+		std::vector<unsigned char> Pixels;
+	};
+	std::vector<Image> images;
+	static bool tallerFirst(const Image *a, const Image *b)
+	{
+		return a->Height != b->Height ? a->Height > b->Height : a->Width > b->Width;
+	}
+	// Copies image into the padded slot at (x, y), extruding its border into the padding
+	void blit(const Image &image, size_t page, GLuint x, GLuint y)
+	{
+		std::vector<unsigned char> &pixels = this->Pages[page];
+		GLuint paddedWidth = image.Width + 2 * this->Padding;
+		GLuint paddedHeight = image.Height + 2 * this->Padding;
+		for (GLuint row = 0; row < paddedHeight; ++row)
+		{
+			GLuint srcRow = (GLuint)std::min(std::max((int)row - (int)this->Padding, 0), (int)image.Height - 1);
+			for (GLuint column = 0; column < paddedWidth; ++column)
+			{
+				GLuint srcColumn = (GLuint)std::min(std::max((int)column - (int)this->Padding, 0), (int)image.Width - 1);
+				const unsigned char *src = &image.Pixels[(srcRow * image.Width + srcColumn) * 4];
+				unsigned char *dst = &pixels[((y + row) * this->PageWidth + x + column) * 4];
+				std::memcpy(dst, src, 4);
+			}
+		}
+	}
+};
+
+// GPU side of an atlas: the uploaded pages and the named regions
+// pointing into them.
+class TextureAtlas
+{
+public:
+	std::vector<Texture2D> Pages;
+	std::map<std::string, AtlasRegion> Regions;
+	// Constructor
+	TextureAtlas() { }
+	// Uploads the pages packed by builder
+	void Generate(const TextureAtlasBuilder &builder)
+	{
+		this->Pages.clear();
+		for (size_t i = 0; i < builder.Pages.size(); ++i)
+			this->Pages.push_back(uploadPage(builder.PageWidth, builder.PageHeight, &builder.Pages[i][0]));
+		this->Regions = builder.Regions;
+		this->bindRegions();
+	}
+	// Loads an atlas written by TextureAtlasBuilder::Save from its .atlas index file
+	bool Load(const GLchar *indexFile)
+	{
+		FILE *index = std::fopen(indexFile, "rb");
+		if (index == nullptr)
+			return false;
+		GLuint magic = readUint(index), version = readUint(index);
+		if (magic != TextureAtlasBuilder::IndexMagic || version != TextureAtlasBuilder::IndexVersion)
+		{
+			std::cout << "ERROR::ATLAS: Unsupported index file " << indexFile << std::endl;
+			std::fclose(index);
+			return false;
+		}
+		GLuint pageWidth = readUint(index), pageHeight = readUint(index);
+		std::string directory(indexFile);
+		size_t slash = directory.find_last_of("/\\");
+		directory = slash == std::string::npos ? "" : directory.substr(0, slash + 1);
+
+		bool success = true;
+		this->Pages.clear();
+		this->Regions.clear();
+		GLuint pageCount = readUint(index);
+		for (GLuint i = 0; i < pageCount && success; ++i)
+		{
+			std::string name;
+			if (!readString(index, name))
+			{
+				std::cout << "ERROR::ATLAS: Corrupt index file " << indexFile << std::endl;
+				success = false;
+				break;
+			}
+			std::string file = directory + name;
+			int width, height;
+			unsigned char *image = SOIL_load_image(file.c_str(), &width, &height, 0, SOIL_LOAD_RGBA);
+			if (image == nullptr || (GLuint)width != pageWidth || (GLuint)height != pageHeight)
+			{
+				std::cout << "ERROR::ATLAS: Failed to load page " << file << std::endl;
+				success = false;
+			}
+			else
+				this->Pages.push_back(uploadPage(pageWidth, pageHeight, image));
+			if (image != nullptr)
+				SOIL_free_image_data(image);
+		}
+		GLuint regionCount = success ? readUint(index) : 0;
+		for (GLuint i = 0; i < regionCount; ++i)
+		{
+			std::string name;
+			if (!readString(index, name))
+			{
+				std::cout << "ERROR::ATLAS: Corrupt index file " << indexFile << std::endl;
+				success = false;
+				break;
+			}
+			AtlasRegion region;
+			region.Page = readUint(index);
+			region.X = readUint(index);
+			region.Y = readUint(index);
+			region.Width = readUint(index);
+			region.Height = readUint(index);
+			region.UV = TextureAtlasBuilder::regionUV(region, pageWidth, pageHeight);
+			if (region.Page < this->Pages.size())
+				this->Regions[name] = region;
+		}
+		std::fclose(index);
+		this->bindRegions();
+		return success;
+	}
+	// Retrieves a named region
+	AtlasRegion GetRegion(const std::string &name)
+	{
+		return this->Regions[name];
+	}
+	bool HasRegion(const std::string &name) const
+	{
+		return this->Regions.count(name) > 0;
+	}
+private:
+	static Texture2D uploadPage(GLuint width, GLuint height, const unsigned char *pixels)
+	{
+		Texture2D page;
+		page.Internal_Format = GL_RGBA;
+		page.Image_Format = GL_RGBA;
+		page.Wrap_S = GL_CLAMP_TO_EDGE;
+		page.Wrap_T = GL_CLAMP_TO_EDGE;
+		page.Generate(width, height, const_cast<unsigned char*>(pixels));
+		return page;
+	}
+	void bindRegions()
+	{
+		for (std::map<std::string, AtlasRegion>::iterator it = this->Regions.begin(); it != this->Regions.end(); ++it)
+			it->second.TextureID = this->Pages[it->second.Page].ID;
+	}
+	static GLuint readUint(FILE *file)
+	{
+		unsigned char bytes[4] = { 0, 0, 0, 0 };
+		if (std::fread(bytes, 1, 4, file) != 4)
+			return 0;
+		return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((GLuint)bytes[3] << 24);
+	}
+	// Names and page files are short, a longer length means a corrupt index
+	static const GLuint MaxStringLength = 4096;
+	// Reads a length prefixed string; false if it is cut off or too long
+	static bool readString(FILE *file, std::string &value)
+	{
+		GLuint length = readUint(file);
+		value.clear();
+		if (length > MaxStringLength)
+			return false;
+		value.resize(length);
+		return length == 0 || std::fread(&value[0], 1, length, file) == length;
+	}
+};
+
+#endif
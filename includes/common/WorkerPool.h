@@ -0,0 +1,113 @@
+#ifndef WORKER_POOL_H
+#define WORKER_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// WorkerPool keeps a fixed set of threads for frame preparation.
+// ParallelFor splits a range into one contiguous chunk per thread and
+// runs them concurrently; the calling thread takes the first chunk and
+// the call returns once every chunk is done. Workers never touch
+// OpenGL, they record into CommandLists that the GL thread replays.
+class WorkerPool
+{
+public:
+	// Work on the items [begin, end), worker is the index of the executing thread
+	typedef std::function<void(size_t begin, size_t end, unsigned worker)> Task;
+	// Constructor (threads includes the calling thread, 0 picks one per hardware thread)
+	explicit WorkerPool(unsigned threads = 0)
+		: task(nullptr), count(0), generation(0), pending(0), stopping(false)
+	{
+		if (threads == 0)
+			threads = std::max(1u, std::thread::hardware_concurrency());
+		for (unsigned i = 1; i < threads; ++i)
+			this->workers.push_back(std::thread(&WorkerPool::run, this, i));
+	}
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool &operator=(const WorkerPool&) = delete;
+	// Destructor (joins the threads)
+	~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->stopping = true;
+		}
+		this->wake.notify_all();
+		for (size_t i = 0; i < this->workers.size(); ++i)
+			this->workers[i].join();
+	}
+	// Number of threads taking part in ParallelFor, including the caller
+	unsigned Threads() const
+	{
+		return (unsigned)this->workers.size() + 1;
+	}
+	// Runs task over [0, count) split across all threads and waits for it
+	void ParallelFor(size_t count, const Task &task)
+	{
+		if (this->workers.empty() || count < this->Threads())
+		{
+			task(0, count, 0);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+			this->task = &task;
+			this->count = count;
+			this->pending = (unsigned)this->workers.size();
+			this->generation++;
+		}
+		this->wake.notify_all();
+		size_t end;
+		this->chunk(0, &end);
+		task(0, end, 0);
+		std::unique_lock<std::mutex> lock(this->mutex);
+		this->done.wait(lock, [this]() { return this->pending == 0; });
+		this->task = nullptr;
+	}
+private:
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	const Task *task;
+	size_t count;
+	unsigned generation;
+	unsigned pending;
+	bool stopping;
+	// Range of items handled by a thread
+	size_t chunk(unsigned worker, size_t *end) const
+	{
+		size_t threads = this->Threads();
+		*end = this->count * (worker + 1) / threads;
+		return this->count * worker / threads;
+	}
+	void run(unsigned worker)
+	{
+		unsigned seen = 0;
+		for (;;)
+		{
+			const Task *current;
+			size_t begin, end;
+			{
+				std::unique_lock<std::mutex> lock(this->mutex);
+				this->wake.wait(lock, [this, seen]() { return this->stopping || this->generation != seen; });
+				if (this->stopping)
+					return;
+				seen = this->generation;
+				current = this->task;
+				begin = this->chunk(worker, &end);
+			}
+			(*current)(begin, end, worker);
+			{
+				std::lock_guard<std::mutex> lock(this->mutex);
+				if (--this->pending == 0)
+					this->done.notify_one();
+			}
+		}
+	}
+};
+
+#endif
@@ -2,6 +2,7 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <common/GLState.h>
 #include <glm/glm.hpp>
 
 #include <string>
@@ -102,7 +103,7 @@ public:
     // ------------------------------------------------------------------------
     void use() 
     { 
-        glUseProgram(ID); 
+        GLState::UseProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
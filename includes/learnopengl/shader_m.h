@@ -2,6 +2,7 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <common/GLState.h>
 #include <glm/glm.hpp>
 
 #include <string>
@@ -74,7 +75,7 @@ public:
     // ------------------------------------------------------------------------
     void use() const
     { 
-        glUseProgram(ID); 
+        GLState::UseProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
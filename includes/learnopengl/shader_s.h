@@ -2,6 +2,7 @@
 #define SHADER_H
 
 #include <glad/glad.h>
+#include <common/GLState.h>
 
 #include <string>
 #include <fstream>
@@ -76,7 +77,7 @@ public:
     // ------------------------------------------------------------------------
     void use()
     {
-        glUseProgram(ID);
+        GLState::UseProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
@@ -0,0 +1,148 @@
+// Benchmark of multithreaded frame preparation: a scene of bouncing
+// sprites is simulated and recorded into CommandLists by a WorkerPool,
+// then merged and radix-sorted by a RenderQueue. Runs once on the
+// calling thread only and once on all threads and reports the speedup.
+// Only the CPU side is measured, replaying the packets needs a GL thread.
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include <common/CommandList.h>
+#include <common/RenderQueue.h>
+#include <common/WorkerPool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Structure-of-arrays scene state
+struct Scene
+{
+	std::vector<float> posX, posY, velX, velY, sizeX, sizeY, rotate, spin, pivotY, depth;
+	std::vector<GLuint> page, layer;
+	std::vector<SpriteMaterial> material;
+	std::vector<SpriteAffine> affines;
+};
+
+static void createScene(Scene &scene, size_t count)
+{
+	std::srand(42);
+	scene.posX.resize(count); scene.posY.resize(count);
+	scene.velX.resize(count); scene.velY.resize(count);
+	scene.sizeX.resize(count); scene.sizeY.resize(count);
+	scene.rotate.resize(count); scene.spin.resize(count);
+	scene.pivotY.resize(count); scene.depth.resize(count);
+	scene.page.resize(count); scene.layer.resize(count);
+	scene.material.resize(count);
+	scene.affines.resize(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		scene.posX[i] = (float)(std::rand() % 800);
+		scene.posY[i] = (float)(std::rand() % 600);
+		scene.velX[i] = (float)(std::rand() % 200) - 100.0f;
+		scene.velY[i] = (float)(std::rand() % 200) - 100.0f;
+		scene.sizeX[i] = 8.0f + (float)(std::rand() % 56);
+		scene.sizeY[i] = 8.0f + (float)(std::rand() % 56);
+		scene.rotate[i] = (float)std::rand() / RAND_MAX * glm::two_pi<float>();
+		scene.spin[i] = (float)std::rand() / RAND_MAX - 0.5f;
+		scene.pivotY[i] = 0.5f;
+		scene.depth[i] = (float)std::rand() / RAND_MAX;
+		scene.page[i] = 1 + std::rand() % 4;
+		scene.layer[i] = std::rand() % 3;
+		scene.material[i] = (SpriteMaterial)(std::rand() % 3);
+	}
+}
+
+// Simulates and records the sprites [begin, end) into list
+static void prepare(Scene &scene, size_t begin, size_t end, float dt, CommandList &list)
+{
+	for (size_t i = begin; i < end; ++i)
+	{
+		scene.posX[i] += scene.velX[i] * dt;
+		scene.posY[i] += scene.velY[i] * dt;
+		if (scene.posX[i] < 0.0f || scene.posX[i] > 800.0f)
+			scene.velX[i] = -scene.velX[i];
+		if (scene.posY[i] < 0.0f || scene.posY[i] > 600.0f)
+			scene.velY[i] = -scene.velY[i];
+		scene.rotate[i] += scene.spin[i] * dt;
+	}
+	SpriteTransformInput in = { &scene.posX[begin], &scene.posY[begin], &scene.sizeX[begin], &scene.sizeY[begin], &scene.rotate[begin], &scene.pivotY[begin] };
+	SpriteTransform::ComputeAffines(in, end - begin, &scene.affines[begin]);
+	for (size_t i = begin; i < end; ++i)
+	{
+		float u = (float)((scene.page[i] * 7) % 4) * 0.25f;
+		list.DrawAffine(scene.layer[i], scene.material[i], scene.depth[i], GL_TEXTURE_2D, scene.page[i], 0,
+			glm::vec4(u, 0.0f, 0.25f, 0.25f), scene.affines[i], glm::vec3(1.0f));
+	}
+}
+
+struct Timing
+{
+	double Prepare, Sort;
+	uint64_t Checksum;
+};
+
+// Runs frames of the scene on pool and returns the mean milliseconds per frame
+static Timing run(WorkerPool &pool, size_t count, int frames)
+{
+	Scene scene;
+	createScene(scene, count);
+	std::vector<CommandList> lists(pool.Threads());
+	for (size_t i = 0; i < lists.size(); ++i)
+		lists[i].Reserve(count / lists.size() + 1);
+	RenderQueue queue;
+	Timing timing = { 0.0, 0.0, 0 };
+	for (int frame = 0; frame < frames; ++frame)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		pool.ParallelFor(count, [&](size_t begin, size_t end, unsigned worker) {
+			lists[worker].Reset();
+			prepare(scene, begin, end, 1.0f / 120.0f, lists[worker]);
+		});
+		std::chrono::steady_clock::time_point recorded = std::chrono::steady_clock::now();
+		for (size_t i = 0; i < lists.size(); ++i)
+			queue.Append(lists[i]);
+		queue.Prepare();
+		std::chrono::steady_clock::time_point sorted = std::chrono::steady_clock::now();
+		timing.Prepare += std::chrono::duration<double, std::milli>(recorded - start).count();
+		timing.Sort += std::chrono::duration<double, std::milli>(sorted - recorded).count();
+		if (frame == frames - 1)
+			for (size_t i = 0; i < queue.Size(); ++i)
+				timing.Checksum = timing.Checksum * 31 + queue.Sorted(i).Key;
+		queue.Clear();
+	}
+	timing.Prepare /= frames;
+	timing.Sort /= frames;
+	return timing;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t count = argc > 1 ? (size_t)std::atoi(argv[1]) : 200000;
+	int frames = argc > 2 ? std::atoi(argv[2]) : 60;
+	unsigned threads = argc > 3 ? (unsigned)std::atoi(argv[3]) : 0;
+
+	WorkerPool serial(1);
+	WorkerPool parallel(threads);
+	Timing one = run(serial, count, frames);
+	Timing many = run(parallel, count, frames);
+
+	std::cout << count << " sprites, " << frames << " frames, transform kernel " << SpriteTransform::KernelName() << std::endl;
+	std::cout << "1 thread:   prepare " << one.Prepare << " ms, merge+sort " << one.Sort << " ms" << std::endl;
+	std::cout << parallel.Threads() << " threads: prepare " << many.Prepare << " ms, merge+sort " << many.Sort << " ms" << std::endl;
+	// with a single hardware thread the workers only take turns, the second run measures overhead
+	if (std::thread::hardware_concurrency() == 1 || parallel.Threads() == 1)
+		std::cout << "no speedup to report: only one hardware thread is available, run on a multi-core machine to compare" << std::endl;
+	else
+		std::cout << "prepare speedup " << one.Prepare / many.Prepare << "x, frame speedup "
+			<< (one.Prepare + one.Sort) / (many.Prepare + many.Sort) << "x" << std::endl;
+	if (one.Checksum != many.Checksum)
+	{
+		std::cout << "ERROR: sorted draw order differs between the runs" << std::endl;
+		return 1;
+	}
+	return 0;
+}
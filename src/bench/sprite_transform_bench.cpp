@@ -0,0 +1,93 @@
+// Micro-benchmark of the sprite transform kernels against the glm
+// translate/rotate/translate/scale chain that SpriteRenderer used to
+// build for every sprite.
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <common/SpriteTransform.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+// Original per-sprite model matrix of SpriteRenderer::DrawSprite
+static glm::mat4 glmModel(glm::vec2 position, glm::vec2 size, float rotate, float yRot)
+{
+	glm::mat4 model;
+	model = glm::translate(model, glm::vec3(position, 0.0f));
+	model = glm::translate(model, glm::vec3(0.5f * size.x, yRot * size.y, 0.0f));
+	model = glm::rotate(model, rotate, glm::vec3(0.0f, 0.0f, 1.0f));
+	model = glm::translate(model, glm::vec3(-0.5f * size.x, -yRot * size.y, 0.0f));
+	model = glm::scale(model, glm::vec3(size, 1.0f));
+	return model;
+}
+
+// Runs func iterations times and returns the best time per sprite in nanoseconds
+template <typename Func>
+static double measure(Func func, size_t sprites, int iterations)
+{
+	double best = 1e30;
+	for (int i = 0; i < iterations; ++i)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		func();
+		std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::min(best, elapsed.count() / sprites);
+	}
+	return best;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t count = argc > 1 ? (size_t)std::atoi(argv[1]) : 100000;
+	int iterations = argc > 2 ? std::atoi(argv[2]) : 50;
+
+	// Random sprites in an 800x600 scene
+	std::vector<float> posX(count), posY(count), sizeX(count), sizeY(count), rotate(count), pivotY(count);
+	std::srand(42);
+	for (size_t i = 0; i < count; ++i)
+	{
+		posX[i] = (float)(std::rand() % 800);
+		posY[i] = (float)(std::rand() % 600);
+		sizeX[i] = 8.0f + (float)(std::rand() % 120);
+		sizeY[i] = 8.0f + (float)(std::rand() % 120);
+		rotate[i] = ((float)std::rand() / RAND_MAX - 0.5f) * 4.0f * glm::pi<float>();
+		pivotY[i] = (float)std::rand() / RAND_MAX;
+	}
+	SpriteTransformInput in = { &posX[0], &posY[0], &sizeX[0], &sizeY[0], &rotate[0], &pivotY[0] };
+
+	std::vector<glm::mat4> models(count);
+	std::vector<SpriteAffine> scalar(count), simd(count);
+
+	double glmTime = measure([&]() {
+		for (size_t i = 0; i < count; ++i)
+			models[i] = glmModel(glm::vec2(posX[i], posY[i]), glm::vec2(sizeX[i], sizeY[i]), rotate[i], pivotY[i]);
+	}, count, iterations);
+	double scalarTime = measure([&]() { SpriteTransform::ComputeAffinesScalar(in, count, &scalar[0]); }, count, iterations);
+	double simdTime = measure([&]() { SpriteTransform::ComputeAffines(in, count, &simd[0]); }, count, iterations);
+
+	// Compare the transformed corners of every kernel with the glm reference
+	float maxError = 0.0f;
+	for (size_t i = 0; i < count; ++i)
+	{
+		for (int corner = 0; corner < 4; ++corner)
+		{
+			float u = (float)(corner & 1), v = (float)(corner >> 1);
+			glm::vec4 reference = models[i] * glm::vec4(u, v, 0.0f, 1.0f);
+			glm::vec2 a = SpriteTransform::Apply(scalar[i], u, v);
+			glm::vec2 b = SpriteTransform::Apply(simd[i], u, v);
+			maxError = std::max(maxError, glm::length(glm::vec2(reference) - a));
+			maxError = std::max(maxError, glm::length(glm::vec2(reference) - b));
+		}
+	}
+
+	std::cout << "sprites: " << count << ", iterations: " << iterations << std::endl;
+	std::cout << "glm mat4 chain:  " << glmTime << " ns/sprite" << std::endl;
+	std::cout << "affine scalar:   " << scalarTime << " ns/sprite (" << glmTime / scalarTime << "x)" << std::endl;
+	std::cout << "affine " << SpriteTransform::KernelName() << ":" << std::string(9 - std::string(SpriteTransform::KernelName()).size(), ' ')
+		<< simdTime << " ns/sprite (" << glmTime / simdTime << "x)" << std::endl;
+	std::cout << "max corner error: " << maxError << " px" << std::endl;
+	return maxError < 0.05f ? 0 : 1;
+}
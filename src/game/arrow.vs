@@ -4,10 +4,16 @@ layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
 out vec2 TexCoords;
 
 uniform mat4 model;
-uniform mat4 projection;
+layout (std140) uniform FrameConstants
+{
+    mat4 projection;
+    vec4 viewport;
+    float time;
+};
+uniform vec4 uvRect; // <vec2 offset, vec2 extent> of the sprite within its texture
 
 void main()
 {
-    TexCoords = vertex.zw;
+    TexCoords = uvRect.xy + vertex.zw * uvRect.zw;
     gl_Position = projection * model * vec4(vertex.xy, 0.0, 1.0);
 }
@@ -0,0 +1,12 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 color;
+
+uniform sampler2D image;
+uniform float intensity; // scale of the glow, added onto the frame
+
+void main()
+{
+    // the pyramid already blurred the bright pass, one bilinear tap upsamples it smoothly enough
+    color = vec4(texture(image, TexCoords).rgb * intensity, 0.0);
+}
@@ -0,0 +1,24 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 color;
+
+uniform sampler2D image;
+uniform vec2 halfPixel; // of the target
+uniform float threshold; // brightness where the glow starts
+uniform float knee; // the start is softened over this much either way
+
+void main()
+{
+    // dual filter downsample of the frame, then a soft threshold on the largest channel
+    vec3 sum = texture(image, TexCoords).rgb * 4.0;
+    sum += texture(image, TexCoords - halfPixel).rgb;
+    sum += texture(image, TexCoords + halfPixel).rgb;
+    sum += texture(image, TexCoords + vec2(halfPixel.x, -halfPixel.y)).rgb;
+    sum += texture(image, TexCoords - vec2(halfPixel.x, -halfPixel.y)).rgb;
+    vec3 rgb = sum / 8.0;
+    float brightness = max(rgb.r, max(rgb.g, rgb.b));
+    float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+    soft = soft * soft / (4.0 * knee + 1e-5);
+    float contribution = max(soft, brightness - threshold) / max(brightness, 1e-5);
+    color = vec4(rgb * contribution, 1.0);
+}
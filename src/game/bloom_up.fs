@@ -0,0 +1,20 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 color;
+
+uniform sampler2D image;
+uniform vec2 halfPixel; // of the target
+
+void main()
+{
+    // dual filter upsample: a tent of eight bilinear taps around the pixel
+    vec3 sum = texture(image, TexCoords + vec2(-halfPixel.x * 2.0, 0.0)).rgb;
+    sum += texture(image, TexCoords + vec2(-halfPixel.x, halfPixel.y)).rgb * 2.0;
+    sum += texture(image, TexCoords + vec2(0.0, halfPixel.y * 2.0)).rgb;
+    sum += texture(image, TexCoords + vec2(halfPixel.x, halfPixel.y)).rgb * 2.0;
+    sum += texture(image, TexCoords + vec2(halfPixel.x * 2.0, 0.0)).rgb;
+    sum += texture(image, TexCoords + vec2(halfPixel.x, -halfPixel.y)).rgb * 2.0;
+    sum += texture(image, TexCoords + vec2(0.0, -halfPixel.y * 2.0)).rgb;
+    sum += texture(image, TexCoords + vec2(-halfPixel.x, -halfPixel.y)).rgb * 2.0;
+    color = vec4(sum / 12.0, 0.0);
+}
@@ -14,41 +14,116 @@
 #include <iostream>
 #include <chrono>
 #include <ctime>
+#include <algorithm>
 
 #include <common/ResourceManager.h>
 std::map<std::string, Shader>    ResourceManager::Shaders;
 std::map<std::string, Texture2D> ResourceManager::Textures;
+std::map<std::string, TextureAtlas> ResourceManager::Atlases;
+std::map<std::string, TextureLayer> ResourceManager::TextureLayers;
+std::vector<TextureArray> ResourceManager::TextureArrays;
+std::vector<ResourceManager::PendingLayer> ResourceManager::PendingLayers;
 #include <common/SpriteRenderer.h>
+#include <common/SpriteBatch.h>
+#include <common/RenderQueue.h>
+#include <common/CachedLayer.h>
+#include <common/FrameConstants.h>
+#include <common/DynamicResolution.h>
+#include <common/FramePacer.h>
+#include <common/FixedTimestep.h>
+#include <common/FrameCapture.h>
+#include <common/ProgramCache.h>
+#include <common/ParticleSystem.h>
+#include <common/TextRenderer.h>
+#include <common/Bloom.h>
+#ifdef SPACE_HOLE_HEADLESS
+#include <common/HeadlessContext.h>
+#include <common/PngWriter.h>
+#include <fstream>
+#endif
 
 #include <irrklang/irrKlang.h>
 using namespace irrklang;
 
+GLFWwindow *createWindow();
+void playSound(const char *path, bool loop);
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void cursor_position_callback(GLFWwindow* window, double xpos, double ypos);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode);
 void processInput(GLFWwindow* window);
-void calculateBallPosition(float *x, float *y);
+void simulate();
+void calculateBallPosition(float distance, float *x, float *y);
 void calculateBallCollisions();
-void renderMenu(SpriteRenderer *sprite);
+void renderMenu(RenderQueue *queue);
+void renderHud(TextRenderer *text);
 void updateLevel();
 void initStatusObjects();
+void updateView(int width, int height);
+void emitFireworks();
 
 // settings
+// the game is laid out in SCR_WIDTH x SCR_HEIGHT units whatever the window size
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
+// bounds of the internal resolution, as a fraction of the window, and the GPU time it aims for
+const float MIN_RENDER_SCALE = 0.5f;
+const float MAX_RENDER_SCALE = 1.0f;
+const float TARGET_GPU_MS = 12.0f;
+// 0 upscales with a bilinear blit, above 0 with a sharpening pass
+const float UPSCALE_SHARPNESS = 0.5f;
+// presentation: swap interval and frame rate cap (0 for none), the cap also holds when the driver ignores vsync
+const SwapMode SWAP_MODE = SwapAdaptive;
+const float FRAME_LIMIT_FPS = 120.0f;
+// the game advances in fixed ticks whatever the frame rate
+const float SIMULATION_HZ = 120.0f;
+// hoops that clear a level
+const int HOOPS_PER_LEVEL = 2;
+// linked shader programs are cached here between launches
+const char *PROGRAM_CACHE_DIRECTORY = "program_cache";
+// submit every shader program before waiting for any, so the driver can compile them in parallel
+const bool PARALLEL_SHADER_COMPILE = true;
+// particle ring size, and whether particles are simulated by a compute shader when GL 4.3 is there
+const unsigned int PARTICLE_CAPACITY = 1 << 20;
+const bool PARTICLE_COMPUTE = true;
+// particles per simulation tick of the ball's trail, per hole capture and per firework on the win screen
+const unsigned int TRAIL_PARTICLES = 48;
+const unsigned int CAPTURE_PARTICLES = 20000;
+const unsigned int FIREWORK_PARTICLES = 100000;
+// ball and hole are drawn as distance field shapes instead of their textures
+const bool SDF_SHAPES = true;
+// HUD line height in game units, and the distance field font written by the font_builder tool
+const float HUD_TEXT_HEIGHT = 30.0f;
+const char *HUD_FONT = "resources/fonts/hud.font";
+// glow of the bright parts of the scene: on by default (--no-bloom), size of the bright pass
+// relative to the scene (--bloom-resolution) and downsample passes below it (--bloom-passes)
+const bool BLOOM = true;
+const float BLOOM_RESOLUTION = 0.5f;
+const unsigned int BLOOM_PASSES = 5;
+
+// View
+FrameConstants *frameConstants;
+// part of the window showing the game, letterboxed to keep its aspect ratio
+glm::ivec4 presentViewport;
+bool letterboxed;
 
 // Status
 enum GameStatus {menu, pointing, shooting, won, lost};
 GameStatus status;
+// Draw order, sprites of a lower layer are drawn first
+enum DrawLayer {backgroundLayer, actorLayer};
+int level;
 int hoopCount;
 int mistakeCount;
 ISoundEngine* engine;
+// Effects, emitted by the simulation
+ParticleSystem *particles;
+int wonTicks;
 
 // Objects status
 
 // Arrow
 float arrowRot;
-float arrowRotInc;
+float arrowRotInc; // per simulation tick
 float arrowLength;
 float arrowWidth;
 float arrowPosX;
@@ -56,7 +131,7 @@ float arrowPosY;
 
 // Ball status
 float ballPos;
-float ballPosInc;
+float ballPosInc; // per simulation tick
 float ballRot;
 float ballDiameter;
 float ballPosX;
@@ -69,185 +144,658 @@ float holePosY;
 
 // Menu Status
 std::string menuStatus = "menu_start";
-std::chrono::time_point<std::chrono::system_clock> startTime;
+std::chrono::steady_clock::time_point startTime;
+
+// Moving parts of the simulation, the previous tick is kept to interpolate between
+struct SimState
+{
+  float arrowRot;
+  float ballPos;
+};
+SimState previousState;
 
 // Input status
 GLboolean Keys[1024];
 GLboolean KeysProcessed[1024];
 
-int main()
+// Options of every run
+//   game [--capture <path> [--capture-format png|y4m|raw]] [--no-program-cache]
+//        [--no-bloom] [--bloom-resolution <fraction>] [--bloom-passes <n>]
+struct Options
 {
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-		glfwWindowHint(GLFW_RESIZABLE, GL_FALSE);
+  std::string capturePath;     // frame capture, off without a path
+  CaptureFormat captureFormat;
+  bool programCache;           // linked shader programs are kept in PROGRAM_CACHE_DIRECTORY
+  bool bloom;
+  float bloomResolution;
+  unsigned int bloomPasses;
+  Options() : captureFormat(CapturePng), programCache(true), bloom(BLOOM), bloomResolution(BLOOM_RESOLUTION), bloomPasses(BLOOM_PASSES) { }
+};
+bool parseOptions(int argc, char *argv[], Options &options);
 
-#ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // uncomment this statement to fix compilation on OS X
+#ifdef SPACE_HOLE_HEADLESS
+// Headless run: the render loop draws a fixed number of frames offscreen with scripted input
+//   game --headless <frames> [--output <dir>] [--snapshot <frame>]... [--play] [--shoot <frame>]...
+struct HeadlessOptions
+{
+  int frames;
+  std::string output;
+  std::vector<int> snapshots;  // frames saved as <output>/frame_<n>.png
+  bool play;                   // start in the game instead of the menu
+  std::vector<int> shots;      // frames on which space is pressed
+  HeadlessOptions() : frames(0), output("."), play(false) { }
+};
+bool parseHeadlessOptions(int argc, char *argv[], HeadlessOptions &options);
+void writeFrameTimes(const HeadlessOptions &options, std::vector<float> frameTimes);
 #endif
 
-    // glfw window creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Space Hole", NULL, NULL);
-    if (window == NULL)
+int main(int argc, char *argv[])
+{
+    // startup is measured up to the first frame
+    std::chrono::steady_clock::time_point launchTime = std::chrono::steady_clock::now();
+    GLFWwindow* window = NULL;
+    // frames are presented into the window, or into an offscreen screen when headless
+    GLuint screenFramebuffer = 0;
+    Options options;
+    if (!parseOptions(argc, argv, options))
+      return -1;
+#ifdef SPACE_HOLE_HEADLESS
+    HeadlessOptions headlessOptions;
+    if (!parseHeadlessOptions(argc, argv, headlessOptions))
+      return -1;
+    HeadlessContext *headless = NULL;
+    if (headlessOptions.frames > 0){
+      headless = new HeadlessContext();
+      if (!headless->Create(SCR_WIDTH, SCR_HEIGHT))
+        return -1;
+      screenFramebuffer = headless->Screen().ID;
+    } else
+#endif
     {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
+      window = createWindow();
+      if (window == NULL)
         return -1;
     }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-		glfwSetCursorPosCallback(window, cursor_position_callback);
-    glfwSetKeyCallback(window, key_callback);
 
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+    // vsync, adaptive when the window system can show late frames immediately
+    SwapMode swapMode = SWAP_MODE;
+    FramePacer pacer(FRAME_LIMIT_FPS);
+    if (window){
+      if (swapMode == SwapAdaptive && !glfwExtensionSupported("WGL_EXT_swap_control_tear") && !glfwExtensionSupported("GLX_EXT_swap_control_tear"))
+        swapMode = SwapVsync;
+      glfwSwapInterval(swapMode);
+    } else{
+      // offscreen frames are drawn as fast as possible
+      swapMode = SwapImmediate;
+      pacer.SetTargetFps(0.0f);
     }
 
-    // start the sound engine with default parameters
-    engine = createIrrKlangDevice();
+    // start the sound engine with default parameters, a headless run plays no sound
+    if (window){
+      engine = createIrrKlangDevice();
 
-    if (!engine){
-       return 0; // error starting up the engine
+      if (!engine){
+         return 0; // error starting up the engine
+      }
     }
 
-    engine->play2D(FileSystem::getPath("resources/sounds/breakout.mp3").c_str(), true);
+    playSound("resources/sounds/breakout.mp3", true);
 
 		// GL configuration
 		// enable transparency
-    glEnable(GL_BLEND);
-    glBlendFunc (GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::Enable(GL_BLEND);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     initStatusObjects();
+#ifdef SPACE_HOLE_HEADLESS
+    if (headless && headlessOptions.play)
+      status = pointing;
+#endif
 
-    // build and compile our shader programs
+    // build and compile our shader programs, or load them from the program cache
     // ------------------------------------
-		ResourceManager::LoadShader("arrow.vs", "arrow.fs", nullptr, "arrow");
+    std::chrono::steady_clock::time_point shadersStart = std::chrono::steady_clock::now();
+    if (options.programCache)
+      ProgramCache::SetDirectory(PROGRAM_CACHE_DIRECTORY);
+		const char *shaderFiles[][3] = {
+		  { "arrow.vs", "arrow.fs", "arrow" },
+		  { "sprite_batch.vs", "sprite_batch.fs", "sprite" },
+		  { "sprite_batch_array.vs", "sprite_batch_array.fs", "sprite_array" },
+		  { "sdf_sprite.vs", "sdf_sprite.fs", "sdf_sprite" },
+		  { "upscale.vs", "upscale.fs", "upscale" },
+		  { "text.vs", "text.fs", "text" } };
+		for (size_t i = 0; i < sizeof(shaderFiles) / sizeof(shaderFiles[0]); ++i){
+		  if (PARALLEL_SHADER_COMPILE)
+		    ResourceManager::SubmitShader(shaderFiles[i][0], shaderFiles[i][1], nullptr, shaderFiles[i][2]);
+		  else
+		    ResourceManager::LoadShader(shaderFiles[i][0], shaderFiles[i][1], nullptr, shaderFiles[i][2]);
+		}
+		// particle programs are only needed once something emits, nothing waits for them
+		ResourceManager::SubmitShader("particle.vs", "particle.fs", nullptr, "particle");
+		// the compute program replaces the transform feedback one where it is available
+		bool particleCompute = PARTICLE_COMPUTE && GLAD_GL_VERSION_4_3;
+		if (!particleCompute){
+		  std::vector<std::string> particleVaryings;
+		  particleVaryings.push_back("outPositionVelocity");
+		  particleVaryings.push_back("outLifeSize");
+		  particleVaryings.push_back("outColor");
+		  ResourceManager::SubmitFeedbackShader("particle_update.vs", particleVaryings, "particle_update");
+		}
+		// the bloom passes are skipped until their programs are ready
+		ResourceManager::SubmitShader("upscale.vs", "bloom_extract.fs", nullptr, "bloom_extract");
+		ResourceManager::SubmitShader("upscale.vs", "bloom_down.fs", nullptr, "bloom_down");
+		ResourceManager::SubmitShader("upscale.vs", "bloom_up.fs", nullptr, "bloom_up");
+		ResourceManager::SubmitShader("upscale.vs", "bloom_composite.fs", nullptr, "bloom_composite");
+		if (particleCompute)
+		  ResourceManager::SubmitComputeShader("particle_update.comp", "particle_update_compute");
+		// the loading screen animates until the sprite programs are done; the upscale pass
+		// is not needed to start, it blits until its program is ready. Headless runs wait for
+		// every program, so no pass starts on a frame that depends on the driver's timing
+		GLuint loadingFrames = 0;
+		while (ResourceManager::GetShader("arrow").Compiling() || ResourceManager::GetShader("sprite").Compiling()
+		       || ResourceManager::GetShader("sprite_array").Compiling() || ResourceManager::GetShader("sdf_sprite").Compiling()
+		       || (!window && ResourceManager::ShadersCompiling())){
+		  float pulse = 0.5f + 0.5f * std::sin(std::chrono::duration<float>(std::chrono::steady_clock::now() - shadersStart).count() * 6.0f);
+		  GLState::BindFramebuffer(GL_FRAMEBUFFER, screenFramebuffer);
+		  glClearColor(0.05f * pulse, 0.05f * pulse, 0.1f * pulse, 1.0f);
+		  glClear(GL_COLOR_BUFFER_BIT);
+		  loadingFrames++;
+		  if (window){
+		    glfwSwapBuffers(window);
+		    glfwPollEvents();
+		  }
+		}
+		double shaderMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shadersStart).count();
+
+		// create sprite batch, every sprite of a frame is drawn through it
+		Shader ourShader = ResourceManager::GetShader("sprite");
+		Shader arrayShader = ResourceManager::GetShader("sprite_array");
+		Shader shapeShader = ResourceManager::GetShader("sdf_sprite");
+		SpriteBatch *arrow = new SpriteBatch(ourShader, arrayShader, shapeShader);
+		// draws are queued with a sort key and replayed through the batch in state friendly order
+		RenderQueue *renderQueue = new RenderQueue();
+		GLuint stateChangesRemoved = 0;
+		// background and hole only change with the level, they are cached in an offscreen layer
+		CachedLayer *playfield = new CachedLayer();
+		playfield->Generate(SCR_WIDTH, SCR_HEIGHT, options.bloom ? GL_RGBA16F : GL_RGBA8);
+		glm::vec3 playfieldHole(-1.0f);
 
-		// create arrow sprite
-		Shader ourShader = ResourceManager::GetShader("arrow");
-		SpriteRenderer *arrow = new SpriteRenderer(ourShader);
+		// the scene is drawn at a resolution that follows the GPU time, then upscaled to the window
+		DynamicResolution *resolution = new DynamicResolution(ResourceManager::GetShader("upscale"),
+		                                                      MIN_RENDER_SCALE, MAX_RENDER_SCALE, TARGET_GPU_MS);
+		resolution->Sharpness = UPSCALE_SHARPNESS;
+		// with bloom the scene is drawn in half floats, so additive particles and glows can exceed 1
+		if (options.bloom)
+		  resolution->ColorFormat = GL_RGBA16F;
+		Bloom *bloom = new Bloom(ResourceManager::GetShader("bloom_extract"), ResourceManager::GetShader("bloom_down"),
+		                         ResourceManager::GetShader("bloom_up"), ResourceManager::GetShader("bloom_composite"));
+		bloom->Enabled = options.bloom;
+		bloom->Resolution = options.bloomResolution;
+		bloom->Passes = options.bloomPasses;
+		// snapshots have to be comparable from run to run, headless runs keep the full resolution
+		if (!window)
+		  resolution->MinScale = resolution->MaxScale;
 
-		glm::mat4 projection = glm::ortho(0.0f,
-																			static_cast<GLfloat>(SCR_WIDTH),
-         															static_cast<GLfloat>(SCR_HEIGHT),
-																			0.0f, -1.0f, 1.0f);
+		// trail, hole captures and fireworks, simulated on the GPU
+		particles = new ParticleSystem(PARTICLE_CAPACITY,
+		                               ResourceManager::Shaders.count("particle_update") ? ResourceManager::GetShader("particle_update") : Shader(),
+		                               ResourceManager::GetShader("particle"),
+		                               ResourceManager::Shaders.count("particle_update_compute") ? ResourceManager::GetShader("particle_update_compute") : Shader());
+		particles->Gravity = glm::vec2(0.0f, 60.0f);
+		particles->Drag = 0.8f;
+
+		// HUD text, from the offline font when it was built and generated at startup otherwise
+		SdfFont *hudFont = new SdfFont();
+		if (!hudFont->Load(FileSystem::getPath(HUD_FONT).c_str())){
+		  SdfFontBuilder builder;
+		  builder.Build();
+		  hudFont->Generate(builder);
+		}
+		TextRenderer *hud = new TextRenderer(ResourceManager::GetShader("text"), *hudFont);
+		hud->Outline = 4.0f;
+		hud->OutlineColor = glm::vec4(0.0f, 0.0f, 0.0f, 0.75f);
+
+		// frames are recorded at the logical size, read back asynchronously and written on another thread
+		FrameCapture *capture = NULL;
+		if (!options.capturePath.empty())
+		  capture = new FrameCapture(options.capturePath, options.captureFormat, SCR_WIDTH, SCR_HEIGHT,
+		                             window && FRAME_LIMIT_FPS > 0.0f ? (GLuint)FRAME_LIMIT_FPS : 60);
+
+		// projection, viewport and time reach every shader through one uniform buffer
+		frameConstants = new FrameConstants();
+		int framebufferWidth = SCR_WIDTH, framebufferHeight = SCR_HEIGHT;
+		if (window)
+		  glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+		updateView(framebufferWidth, framebufferHeight);
 		ResourceManager::GetShader("arrow").Use().SetInteger("image", 0);
-		ResourceManager::GetShader("arrow").SetMatrix4("projection", projection);
+		ResourceManager::GetShader("sprite").Use().SetInteger("image", 0);
+		ResourceManager::GetShader("sprite_array").Use().SetInteger("image", 0);
 
 		// load and create a texture
     // objects
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/arrow1.png").c_str(), GL_TRUE, "arrow");
-		ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/burntball.png").c_str(), GL_TRUE, "ball");
-    //menu
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/menu_start.jpg").c_str(), GL_TRUE, "menu_start");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/menu_help.jpg").c_str(), GL_TRUE, "menu_help");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/menu_exit.jpg").c_str(), GL_TRUE, "menu_exit");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/menu_help_instructions.jpg").c_str(), GL_TRUE, "menu_help_instructions");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/menu_start_3.jpg").c_str(), GL_TRUE, "menu_start_3");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/menu_start_2.jpg").c_str(), GL_TRUE, "menu_start_2");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/menu_start_1.jpg").c_str(), GL_TRUE, "menu_start_1");
+    // pack arrow, ball and hole into one atlas page so they share a draw call,
+    // the page written by the atlas_packer tool is used when present
+    if (!ResourceManager::LoadAtlas(FileSystem::getPath("resources/textures/sprites.atlas").c_str(), "sprites")){
+      TextureAtlasBuilder builder;
+      builder.AddFile("arrow", FileSystem::getPath("resources/textures/arrow1.png").c_str());
+      builder.AddFile("ball", FileSystem::getPath("resources/textures/burntball.png").c_str());
+      builder.AddFile("hole", FileSystem::getPath("resources/textures/space-hole.png").c_str());
+      builder.Build();
+      ResourceManager::CreateAtlas(builder, "sprites");
+    }
+    TextureAtlas sprites = ResourceManager::GetAtlas("sprites");
+    AtlasRegion arrowRegion = sprites.GetRegion("arrow");
+    AtlasRegion ballRegion = sprites.GetRegion("ball");
+    AtlasRegion holeRegion = sprites.GetRegion("hole");
+    //menu, screens of the same size share one texture array
+    ResourceManager::LoadTextureLayer(FileSystem::getPath("resources/textures/menu_start.jpg").c_str(), GL_TRUE, "menu_start");
+    ResourceManager::LoadTextureLayer(FileSystem::getPath("resources/textures/menu_help.jpg").c_str(), GL_TRUE, "menu_help");
+    ResourceManager::LoadTextureLayer(FileSystem::getPath("resources/textures/menu_exit.jpg").c_str(), GL_TRUE, "menu_exit");
+    ResourceManager::LoadTextureLayer(FileSystem::getPath("resources/textures/menu_help_instructions.jpg").c_str(), GL_TRUE, "menu_help_instructions");
+    ResourceManager::LoadTextureLayer(FileSystem::getPath("resources/textures/menu_start_3.jpg").c_str(), GL_TRUE, "menu_start_3");
+    ResourceManager::LoadTextureLayer(FileSystem::getPath("resources/textures/menu_start_2.jpg").c_str(), GL_TRUE, "menu_start_2");
+    ResourceManager::LoadTextureLayer(FileSystem::getPath("resources/textures/menu_start_1.jpg").c_str(), GL_TRUE, "menu_start_1");
+    ResourceManager::BuildTextureArrays();
     ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/space.jpg").c_str(), GL_FALSE, "space");
-    ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/space-hole.png").c_str(), GL_TRUE, "hole");
 
     ResourceManager::LoadTexture(FileSystem::getPath("resources/textures/won.jpg").c_str(), GL_TRUE, "won");
 		// render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    FixedTimestep timestep(SIMULATION_HZ);
+    int frame = 0;
+    // offscreen frames advance the game by a fixed 60th of a second, so every run is identical
+    const double offscreenFrameSeconds = 1.0 / 60.0;
+    int offscreenFrames = 0;
+    // particles move with the real frame time, offscreen frames with the fixed one
+    std::chrono::steady_clock::time_point lastFrame = std::chrono::steady_clock::now();
+#ifdef SPACE_HOLE_HEADLESS
+    offscreenFrames = headlessOptions.frames;
+    std::vector<float> frameTimes;
+#endif
+    while (window ? !glfwWindowShouldClose(window) : frame < offscreenFrames)
     {
-        // input
+#ifdef SPACE_HOLE_HEADLESS
+        std::chrono::steady_clock::time_point frameStart = std::chrono::steady_clock::now();
+        if (headless)
+          Keys[GLFW_KEY_SPACE] = std::find(headlessOptions.shots.begin(), headlessOptions.shots.end(), frame) != headlessOptions.shots.end();
+#endif
+        // input and simulation, in fixed ticks; input is read once per tick so the game
+        // reacts the same at any frame rate
         // -----
-        processInput(window);
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+        float frameSeconds = window ? std::min(std::chrono::duration<float>(now - lastFrame).count(), 0.25f) : offscreenFrameSeconds;
+        lastFrame = now;
+        GLuint ticks = window ? timestep.Advance() : timestep.Advance(offscreenFrameSeconds);
+        for (; ticks > 0; --ticks){
+          processInput(window);
+          previousState.arrowRot = arrowRot;
+          previousState.ballPos = ballPos;
+          simulate();
+        }
+        // drawn between the last two ticks
+        float alpha = timestep.Alpha();
+        float drawArrowRot = glm::mix(previousState.arrowRot, arrowRot, alpha);
+        float drawBallPos = glm::mix(previousState.ballPos, ballPos, alpha);
 
         // render
         // ------
-        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
-
-        Texture2D tex;
+        bool drawPlayfield = false;
         if (status == menu){
           //draw menu
-          renderMenu(arrow);
+          renderMenu(renderQueue);
         } else if (status == won){
-          tex = ResourceManager::GetTexture("won");
-          arrow->DrawSprite(tex,
+          Texture2D tex = ResourceManager::GetTexture("won");
+          renderQueue->Submit(backgroundLayer, MaterialOpaque, 1.0f, tex,
                             glm::vec2(0.0f,0.0f),
                             glm::vec2(SCR_WIDTH, SCR_HEIGHT),
                             0.0f,
                             glm::vec3(1.0f, 1.0f, 1.0f));
         } else{
-          // draw background
-          tex = ResourceManager::GetTexture("space");
-          arrow->DrawSprite(tex,
-                            glm::vec2(0.0f,0.0f),
-                            glm::vec2(SCR_WIDTH, SCR_HEIGHT),
-                            0.0f,
-                            glm::vec3(1.0f, 1.0f, 1.0f));
-
-          // draw Hole
-          // TODO scale hole for increasing diffulties
-          tex = ResourceManager::GetTexture("hole");
-          arrow->DrawSprite(tex,
-                            glm::vec2(holePosX, holePosY),
-                            glm::vec2(holeDiameter,holeDiameter),
-                            0.0f,
-                            glm::vec3(1.0f, 1.0f, 1.0f));
-
-          // bind textures on corresponding texture units
-  				tex = ResourceManager::GetTexture("arrow");
-  				tex.Bind();
-
-          if(arrowRot > glm::half_pi<float>() || arrowRot < -glm::half_pi<float>()){
-            arrowRotInc = -arrowRotInc;
+          // background and Hole come from the playfield layer, redrawn only when the level changed the hole
+          drawPlayfield = true;
+          glm::vec3 hole(holePosX, holePosY, holeDiameter);
+          if (hole != playfieldHole){
+            playfield->Invalidate();
+            playfieldHole = hole;
           }
 
-  				arrow->DrawSprite(tex,
+  				renderQueue->Submit(actorLayer, MaterialTranslucent, 0.5f, arrowRegion,
   													glm::vec2(arrowPosX, arrowPosY),
   													glm::vec2(arrowWidth, arrowLength),
-  													arrowRot,
+  													drawArrowRot,
   													glm::vec3(1.0f, 1.0f, 1.0f),
                             0.5f);
 
           if (status==shooting){
-            calculateBallPosition(&ballPosX, &ballPosY);
-
-  					tex = ResourceManager::GetTexture("ball");
-  					arrow->DrawSprite(tex,
-  														glm::vec2(ballPosX, ballPosY),
-  														glm::vec2(ballDiameter, ballDiameter),
-  														ballRot,
-  														glm::vec3(1.0f, 1.0f, 1.0f));
-            calculateBallCollisions();
+            float drawBallX, drawBallY;
+            calculateBallPosition(drawBallPos, &drawBallX, &drawBallY);
+
+            if (SDF_SHAPES){
+              // a glow behind a disc shaded darker towards its rim
+              float glowDiameter = ballDiameter * 1.6f;
+              renderQueue->Submit(actorLayer, MaterialTranslucent, 0.3f, SpriteShape(ShapeGlow, 0.35f),
+                                  glm::vec2(drawBallX, drawBallY) + (ballDiameter - glowDiameter) / 2,
+                                  glm::vec2(glowDiameter, glowDiameter),
+                                  0.0f,
+                                  glm::vec3(1.0f, 0.45f, 0.1f));
+              renderQueue->Submit(actorLayer, MaterialTranslucent, 0.25f, SpriteShape(ShapeCircle, 0.45f),
+                                  glm::vec2(drawBallX, drawBallY),
+                                  glm::vec2(ballDiameter, ballDiameter),
+                                  0.0f,
+                                  glm::vec3(1.0f, 0.6f, 0.2f));
+            } else {
+  					  renderQueue->Submit(actorLayer, MaterialTranslucent, 0.25f, ballRegion,
+  														  glm::vec2(drawBallX, drawBallY),
+  														  glm::vec2(ballDiameter, ballDiameter),
+  														  ballRot,
+  														  glm::vec3(1.0f, 1.0f, 1.0f));
+            }
           }
+        }
+
+        // the color buffer only needs clearing when no full-screen opaque layer or sprite covers it
+        renderQueue->Prepare();
+        resolution->Begin(presentViewport);
+        glm::ivec4 viewport = resolution->Viewport();
+        frameConstants->Viewport = glm::vec4(viewport);
+        frameConstants->Time = window ? static_cast<GLfloat>(glfwGetTime()) : static_cast<GLfloat>(frame * offscreenFrameSeconds);
+        frameConstants->Update();
+        GLbitfield clearMask = GL_DEPTH_BUFFER_BIT;
+        if (!drawPlayfield && !renderQueue->OpaqueCovers(glm::vec2(0.0f, 0.0f), glm::vec2(SCR_WIDTH, SCR_HEIGHT)))
+          clearMask |= GL_COLOR_BUFFER_BIT;
+        glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+        glClear(clearMask);
 
-          if(hoopCount == 2){
-            updateLevel();
+        if (drawPlayfield){
+          GpuScope scope("playfield");
+          if (playfield->BeginUpdate()){
+            Texture2D tex = ResourceManager::GetTexture("space");
+            arrow->Begin();
+            arrow->DrawSprite(tex,
+                              glm::vec2(0.0f,0.0f),
+                              glm::vec2(SCR_WIDTH, SCR_HEIGHT),
+                              0.0f,
+                              glm::vec3(1.0f, 1.0f, 1.0f));
+            // TODO scale hole for increasing diffulties
+            if (SDF_SHAPES){
+              // glow filling the quad, the dark disc and its rim inside it; all three in one draw call
+              float diskDiameter = holeDiameter * 0.8f;
+              glm::vec2 disk = glm::vec2(holePosX, holePosY) + (holeDiameter - diskDiameter) / 2;
+              arrow->DrawSprite(SpriteShape(ShapeGlow, 0.8f),
+                                glm::vec2(holePosX, holePosY),
+                                glm::vec2(holeDiameter,holeDiameter),
+                                0.0f,
+                                glm::vec3(0.95f, 0.4f, 1.0f));
+              arrow->DrawSprite(SpriteShape(ShapeCircle, 0.5f),
+                                disk,
+                                glm::vec2(diskDiameter, diskDiameter),
+                                0.0f,
+                                glm::vec3(0.2f, 0.04f, 0.16f));
+              arrow->DrawSprite(SpriteShape(ShapeRing, 0.05f),
+                                disk,
+                                glm::vec2(diskDiameter, diskDiameter),
+                                0.0f,
+                                glm::vec3(0.5f, 1.3f, 1.6f)); // above 1, it glows with bloom
+            } else {
+              arrow->DrawSprite(holeRegion,
+                                glm::vec2(holePosX, holePosY),
+                                glm::vec2(holeDiameter,holeDiameter),
+                                0.0f,
+                                glm::vec3(1.0f, 1.0f, 1.0f));
+            }
+            arrow->End();
+            playfield->EndUpdate(resolution->Framebuffer(), viewport);
           }
+          playfield->Composite(resolution->Framebuffer(), viewport);
+        }
+        arrow->Begin();
+        renderQueue->Flush(*arrow);
+        arrow->End();
+        particles->Update(frameSeconds);
+        particles->Draw();
+        bloom->Apply(resolution->Target());
 
-          arrowRot += arrowRotInc;
-          ballPos += ballPosInc;
+        // upscale to the window, the bars around a letterboxed view are cleared first
+        if (letterboxed){
+          GLState::BindFramebuffer(GL_FRAMEBUFFER, screenFramebuffer);
+          glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+          glClear(GL_COLOR_BUFFER_BIT);
         }
+        resolution->End(screenFramebuffer);
+        // the HUD goes straight to the window at its full resolution, in one draw call
+        if (drawPlayfield)
+          renderHud(hud);
+        if (capture)
+          capture->Capture(screenFramebuffer, presentViewport);
+        stateChangesRemoved += renderQueue->LastFrame.Removed();
+        GLState::EndFrame();
+        GpuProfiler::EndFrame();
+
+        frame++;
+        if (frame == 1){
+          // time to first frame, the frame included
+          glFinish();
+          ProgramCache::Counters programs = ProgramCache::Total();
+          std::cout << "startup: " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - launchTime).count()
+                    << " ms to the first frame, " << shaderMilliseconds << " ms loading shader programs ("
+                    << programs.Hits << " from the program cache, " << programs.Misses << " compiled, "
+                    << programs.Rejected << " cached binaries rejected, " << loadingFrames << " loading frames)" << std::endl;
+        }
+#ifdef SPACE_HOLE_HEADLESS
+        if (headless){
+          // the frame time includes the GPU work, there is no swap to wait for it
+          glFinish();
+          frameTimes.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+          if (std::find(headlessOptions.snapshots.begin(), headlessOptions.snapshots.end(), frame) != headlessOptions.snapshots.end()){
+            std::vector<unsigned char> pixels;
+            headless->ReadPixels(pixels);
+            std::string path = headlessOptions.output + "/frame_" + std::to_string(frame) + ".png";
+            if (!PngWriter::Write(path.c_str(), SCR_WIDTH, SCR_HEIGHT, 4, &pixels[0]))
+              std::cout << "ERROR::HEADLESS: cannot write " << path << std::endl;
+          }
+          continue;
+        }
+#endif
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
+        // the frame limiter waits before polling so the next frame starts from fresh input
         // -------------------------------------------------------------------------------
         glfwSwapBuffers(window);
+        pacer.Presented();
+        pacer.Wait();
         glfwPollEvents();
     }
+#ifdef SPACE_HOLE_HEADLESS
+    if (headless)
+      writeFrameTimes(headlessOptions, frameTimes);
+#endif
+
+    // the sprite vertex stream should never have waited for the GPU
+    const StreamBuffer &stream = arrow->GetStreamBuffer();
+    std::cout << "sprite stream: " << stream.Stalls << " fence stalls, " << stream.TotalWaitMilliseconds
+              << " ms waited over " << stream.Frames << " frames" << std::endl;
+    std::cout << "playfield layer: redrawn " << playfield->Updates << " times, reused " << playfield->Reuses
+              << " times" << std::endl;
+    std::cout << "dynamic resolution: scale " << resolution->Scale << ", " << resolution->GpuMilliseconds
+              << " ms GPU, " << resolution->ScaledFrames << " of " << resolution->Frames << " frames below full scale, "
+              << resolution->Resizes << " resizes" << std::endl;
+    std::cout << "simulation: " << timestep.Ticks << " ticks at " << SIMULATION_HZ << " Hz, "
+              << timestep.DroppedSeconds << " s dropped by long frames" << std::endl;
+    if (capture){
+      capture->Finish();
+      std::cout << "capture: " << capture->Written() << " frames written, " << capture->Dropped << " dropped, "
+                << capture->OverheadMilliseconds / std::max(1u, capture->Captured + capture->Dropped) << " ms average overhead per frame, "
+                << capture->WriteMilliseconds << " ms writing on the capture thread" << std::endl;
+      delete capture;
+    }
+    std::cout << "text: " << hud->LayoutHits << " layouts reused, " << hud->LayoutMisses << " laid out, "
+              << hud->GlyphCount << " glyphs in " << hud->DrawCalls << " draw calls last frame" << std::endl;
+    if (bloom->Enabled)
+      std::cout << "bloom: " << bloom->Levels() << " levels from " << bloom->Resolution << " of the scene resolution, "
+                << GpuProfiler::Get("bloom").Average << " ms GPU" << std::endl;
+    if (arrow->SkippedSprites)
+      std::cout << "sprite batch: " << arrow->SkippedSprites << " sprites skipped while their program compiled" << std::endl;
+    ParticleSystem::Stats effects = particles->GetStats();
+    std::cout << "particles: " << effects.Live << " live in a window of " << effects.Window << " of " << particles->Capacity
+              << " slots, " << particles->Emitted << " emitted, " << particles->Overwritten << " overwritten, simulated with "
+              << (particles->UsesCompute() ? "a compute shader, " : "transform feedback, ") << effects.SimulateMilliseconds
+              << " ms GPU simulating, " << effects.DrawMilliseconds << " ms GPU drawing" << std::endl;
+    std::cout << "render queue: " << stateChangesRemoved << " state changes removed by sorting" << std::endl;
+    FramePacer::Summary pacing = pacer.Stats();
+    std::cout << "frame pacing: swap interval " << swapMode << ", " << pacing.Average << " ms average interval, "
+              << pacing.Jitter << " ms jitter, " << pacing.P99 << " ms p99, " << pacing.Max << " ms max, "
+              << pacing.Late << " late frames, " << pacer.SleptMilliseconds << " ms slept, "
+              << pacer.SpunMilliseconds << " ms spun" << std::endl;
+    std::vector<std::string> passes = GpuProfiler::Names();
+    for (size_t i = 0; i < passes.size(); ++i){
+      GpuProfiler::Summary pass = GpuProfiler::Get(passes[i]);
+      std::cout << "gpu " << passes[i] << ": " << pass.Average << " ms average, " << pass.Median << " ms median, "
+                << pass.P95 << " ms p95, " << pass.Max << " ms max" << std::endl;
+    }
+    GLState::Counters binds = GLState::Total();
+    std::cout << "gl state cache: " << binds.Hits << " redundant calls skipped, " << binds.Misses
+              << " issued" << std::endl;
 
-    engine->drop();
+    if (engine)
+      engine->drop();
+#ifdef SPACE_HOLE_HEADLESS
+    if (headless){
+      delete headless;
+      return 0;
+    }
+#endif
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
     return 0;
 }
 
+// glfw: initialize and configure, then create the window and load the OpenGL functions
+// ---------------------------------------------------------------------------------------------------------
+GLFWwindow *createWindow()
+{
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		glfwWindowHint(GLFW_RESIZABLE, GL_TRUE);
+
+#ifdef __APPLE__
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE); // uncomment this statement to fix compilation on OS X
+#endif
+
+    // glfw window creation
+    // --------------------
+    GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "Space Hole", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return NULL;
+    }
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+		glfwSetCursorPosCallback(window, cursor_position_callback);
+    glfwSetKeyCallback(window, key_callback);
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return NULL;
+    }
+    return window;
+}
+
+// Plays a sound of the resources folder, without a sound engine (headless runs) nothing happens
+void playSound(const char *path, bool loop)
+{
+    if (engine)
+      engine->play2D(FileSystem::getPath(path).c_str(), loop);
+}
+
+// Reads the options of every run, headless options are left to parseHeadlessOptions
+bool parseOptions(int argc, char *argv[], Options &options)
+{
+    for (int arg = 1; arg < argc; ++arg){
+      std::string option(argv[arg]);
+      bool hasValue = arg + 1 < argc;
+      if (option == "--capture" && hasValue)
+        options.capturePath = argv[++arg];
+      else if (option == "--capture-format" && hasValue){
+        std::string format(argv[++arg]);
+        if (format == "png")
+          options.captureFormat = CapturePng;
+        else if (format == "y4m")
+          options.captureFormat = CaptureY4m;
+        else if (format == "raw")
+          options.captureFormat = CaptureRaw;
+        else{
+          std::cout << "usage: game [--capture <path> [--capture-format png|y4m|raw]] [--no-program-cache]\n            [--no-bloom] [--bloom-resolution <fraction>] [--bloom-passes <n>]" << std::endl;
+          return false;
+        }
+      }
+      else if (option == "--no-program-cache")
+        options.programCache = false;
+      else if (option == "--no-bloom")
+        options.bloom = false;
+      else if (option == "--bloom-resolution" && hasValue)
+        options.bloomResolution = glm::clamp((float)std::atof(argv[++arg]), 0.05f, 1.0f);
+      else if (option == "--bloom-passes" && hasValue)
+        options.bloomPasses = (unsigned int)std::max(0, std::atoi(argv[++arg]));
+    }
+    return true;
+}
+
+#ifdef SPACE_HOLE_HEADLESS
+bool parseHeadlessOptions(int argc, char *argv[], HeadlessOptions &options)
+{
+    for (int arg = 1; arg < argc; ++arg){
+      std::string option(argv[arg]);
+      bool hasValue = arg + 1 < argc;
+      if (option == "--headless" && hasValue)
+        options.frames = std::atoi(argv[++arg]);
+      else if (option == "--output" && hasValue)
+        options.output = argv[++arg];
+      else if (option == "--snapshot" && hasValue)
+        options.snapshots.push_back(std::atoi(argv[++arg]));
+      else if (option == "--shoot" && hasValue)
+        options.shots.push_back(std::atoi(argv[++arg]));
+      else if (option == "--play")
+        options.play = true;
+      else if ((option == "--capture" || option == "--capture-format" || option == "--bloom-resolution" || option == "--bloom-passes") && hasValue)
+        ++arg; // read by parseOptions
+      else if (option == "--no-program-cache" || option == "--no-bloom")
+        continue;
+      else{
+        std::cout << "usage: game [--headless <frames> [--output <dir>] [--snapshot <frame>]... [--play] [--shoot <frame>]...] [--capture <path> [--capture-format png|y4m|raw]] [--no-program-cache]\n            [--no-bloom] [--bloom-resolution <fraction>] [--bloom-passes <n>]" << std::endl;
+        return false;
+      }
+    }
+    return true;
+}
+
+// Prints the frame time statistics of a headless run and writes every frame to <output>/frame_times.csv
+void writeFrameTimes(const HeadlessOptions &options, std::vector<float> frameTimes)
+{
+    if (frameTimes.empty())
+      return;
+    std::ofstream csv((options.output + "/frame_times.csv").c_str());
+    csv << "frame,milliseconds" << std::endl;
+    for (size_t i = 0; i < frameTimes.size(); ++i)
+      csv << i + 1 << "," << frameTimes[i] << std::endl;
+    std::sort(frameTimes.begin(), frameTimes.end());
+    float sum = 0.0f;
+    for (size_t i = 0; i < frameTimes.size(); ++i)
+      sum += frameTimes[i];
+    size_t count = frameTimes.size();
+    std::cout << "headless: " << count << " frames, " << sum / count << " ms average, "
+              << frameTimes[count / 2] << " ms median, " << frameTimes[std::min(count - 1, count * 95 / 100)] << " ms p95, "
+              << frameTimes[std::min(count - 1, count * 99 / 100)] << " ms p99, " << frameTimes.back() << " ms max" << std::endl;
+}
+#endif
+
 // process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
 // ---------------------------------------------------------------------------------------------------------
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode)
@@ -277,17 +825,73 @@ void cursor_position_callback(GLFWwindow* window, double xpos, double ypos)
 // ---------------------------------------------------------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    // make sure the viewport matches the new window dimensions; note that width and
+    // the projection and the presented viewport follow the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+    updateView(width, height);
+}
+
+// Fits the SCR_WIDTH x SCR_HEIGHT game into the framebuffer, keeping its aspect ratio
+void updateView(int width, int height)
+{
+    if (width <= 0 || height <= 0)
+      return; // minimized
+    float scale = std::min(width / static_cast<float>(SCR_WIDTH), height / static_cast<float>(SCR_HEIGHT));
+    int viewWidth = std::max(1, static_cast<int>(SCR_WIDTH * scale + 0.5f));
+    int viewHeight = std::max(1, static_cast<int>(SCR_HEIGHT * scale + 0.5f));
+    presentViewport = glm::ivec4((width - viewWidth) / 2, (height - viewHeight) / 2, viewWidth, viewHeight);
+    letterboxed = viewWidth != width || viewHeight != height;
+    if (frameConstants)
+      frameConstants->SetView(static_cast<GLfloat>(SCR_WIDTH), static_cast<GLfloat>(SCR_HEIGHT), glm::vec4(presentViewport));
+}
+
+// Advances the game by one fixed tick
+// ---------------------------------------------------------------------------------------------
+void simulate()
+{
+    if (status == won)
+      emitFireworks();
+    if (status != pointing && status != shooting)
+      return;
+
+    if(arrowRot > glm::half_pi<float>() || arrowRot < -glm::half_pi<float>()){
+      arrowRotInc = -arrowRotInc;
+    }
+
+    if (status==shooting){
+      calculateBallPosition(ballPos, &ballPosX, &ballPosY);
+      calculateBallCollisions();
+
+      // exhaust trail, blown out behind the ball
+      ParticleEmitter trail;
+      trail.Position = glm::vec2(ballPosX + ballDiameter/2, ballPosY + ballDiameter/2);
+      trail.Radius = ballDiameter/6;
+      trail.Angle = glm::atan(glm::cos(ballRot), -glm::sin(ballRot));
+      trail.Spread = 0.5f;
+      trail.MinSpeed = 40.0f;
+      trail.MaxSpeed = 160.0f;
+      trail.MinLife = 0.3f;
+      trail.MaxLife = 0.7f;
+      trail.MinSize = 3.0f;
+      trail.MaxSize = 7.0f;
+      trail.ColorA = glm::vec4(1.0f, 0.7f, 0.2f, 0.35f);
+      trail.ColorB = glm::vec4(1.0f, 0.2f, 0.05f, 0.2f);
+      particles->Emit(trail, TRAIL_PARTICLES);
+    }
+
+    if(hoopCount == HOOPS_PER_LEVEL){
+      updateLevel();
+    }
+
+    arrowRot += arrowRotInc;
+    ballPos += ballPosInc;
 }
 
 // Calculate all
 // ---------------------------------------------------------------------------------------------
-void calculateBallPosition(float *x, float *y)
+void calculateBallPosition(float distance, float *x, float *y)
 {
-    *x = arrowPosX - (ballDiameter/2) + (arrowWidth/2)   + (arrowLength/2 + ballPos) * glm::sin(ballRot);
-    *y = arrowPosY - (ballDiameter/2) + (arrowLength/2)  - (arrowLength/2 + ballPos) * glm::cos(ballRot);
+    *x = arrowPosX - (ballDiameter/2) + (arrowWidth/2)   + (arrowLength/2 + distance) * glm::sin(ballRot);
+    *y = arrowPosY - (ballDiameter/2) + (arrowLength/2)  - (arrowLength/2 + distance) * glm::cos(ballRot);
 }
 
 // Calculate all
@@ -311,26 +915,50 @@ void calculateBallCollisions(){
   // http://www.gamasutra.com/view/feature/3015/pool_hall_lessons_fast_accurate_.php
   if((glm::pow(ballCenterX - holeCenterX,2) + glm::pow(ballCenterY - holeCenterY,2)) <= glm::pow(ballRadius - holeRadius,2)){
     hoopCount++;
-    engine->play2D(FileSystem::getPath("resources/sounds/collect.mp3").c_str(), false);
+    playSound("resources/sounds/collect.mp3", false);
     status = pointing;
+
+    // the hole swallows the ball in a burst
+    ParticleEmitter burst;
+    burst.Position = glm::vec2(holeCenterX, holeCenterY);
+    burst.Radius = holeRadius * 0.3f;
+    burst.MinSpeed = 50.0f;
+    burst.MaxSpeed = 350.0f;
+    burst.MinLife = 0.6f;
+    burst.MaxLife = 1.6f;
+    burst.MinSize = 2.0f;
+    burst.MaxSize = 5.0f;
+    burst.ColorA = glm::vec4(0.6f, 0.3f, 1.0f, 1.0f);
+    burst.ColorB = glm::vec4(0.3f, 0.9f, 1.0f, 1.0f);
+    particles->Emit(burst, CAPTURE_PARTICLES);
   }
 
 
 }
 
-void renderMenu(SpriteRenderer *sprite){
-  Texture2D tex = ResourceManager::GetTexture(menuStatus);
-  sprite->DrawSprite(tex,
+void renderMenu(RenderQueue *queue){
+  TextureLayer menuLayer = ResourceManager::GetTextureLayer(menuStatus);
+  queue->Submit(backgroundLayer, MaterialOpaque, 1.0f, menuLayer,
                     glm::vec2(0.0f,0.0f),
                     glm::vec2(SCR_WIDTH, SCR_HEIGHT),
                     0.0f,
                     glm::vec3(1.0f, 1.0f, 1.0f));
 }
 
+// Level and hoops of the level in the top left corner; a miss ends the run, so there is no miss count
+void renderHud(TextRenderer *text){
+  const glm::vec4 white(1.0f, 1.0f, 1.0f, 1.0f);
+  float margin = HUD_TEXT_HEIGHT / 2;
+  text->Begin();
+  text->Draw("LEVEL " + std::to_string(level), glm::vec2(margin, margin), HUD_TEXT_HEIGHT, white);
+  text->Draw("HOOPS " + std::to_string(hoopCount) + "/" + std::to_string(HOOPS_PER_LEVEL), glm::vec2(margin, margin + HUD_TEXT_HEIGHT), HUD_TEXT_HEIGHT, white);
+  text->End();
+}
+
 void processInput(GLFWwindow* window){
   switch (status) {
     case menu:{
-        std::chrono::time_point<std::chrono::system_clock> now = std::chrono::system_clock::now();
+        std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
         int elapsedTime = std::chrono::duration_cast<std::chrono::milliseconds> (now-startTime).count();
         if (Keys[GLFW_KEY_UP] && !KeysProcessed[GLFW_KEY_UP]){
           if (menuStatus == "menu_start"){
@@ -353,18 +981,19 @@ void processInput(GLFWwindow* window){
         } else if (Keys[GLFW_KEY_ENTER] && !KeysProcessed[GLFW_KEY_ENTER]){
           if (menuStatus == "menu_start"){
             menuStatus = "menu_start_3";
-            startTime = std::chrono::system_clock::now();
+            startTime = std::chrono::steady_clock::now();
           } else if (menuStatus == "menu_help"){
             menuStatus = "menu_help_instructions";
           } else if (menuStatus == "menu_exit"){
-            glfwSetWindowShouldClose(window, GL_TRUE);
+            if (window)
+              glfwSetWindowShouldClose(window, GL_TRUE);
           }
           KeysProcessed[GLFW_KEY_ENTER] = GL_TRUE;
         } else if (menuStatus == "menu_start_3" && elapsedTime > 700){
-          startTime = std::chrono::system_clock::now();
+          startTime = std::chrono::steady_clock::now();
           menuStatus = "menu_start_2";
         } else if (menuStatus == "menu_start_2" && elapsedTime > 700){
-          startTime = std::chrono::system_clock::now();
+          startTime = std::chrono::steady_clock::now();
           menuStatus = "menu_start_1";
         } else if (menuStatus == "menu_start_1" && elapsedTime > 700){
           menuStatus = "menu_start";
@@ -378,7 +1007,7 @@ void processInput(GLFWwindow* window){
         ballPos = 0.0f;
         ballRot = arrowRot;
 
-        engine->play2D(FileSystem::getPath("resources/sounds/Shoot.mp3").c_str(), false);
+        playSound("resources/sounds/Shoot.mp3", false);
       }
       break;
     }
@@ -393,6 +1022,7 @@ void processInput(GLFWwindow* window){
 }
 
 void updateLevel(){
+  level++;
   holeDiameter = holeDiameter*2/3;
   holePosX = (SCR_WIDTH * 1/2) - holeDiameter/2;
   holePosY = (SCR_HEIGHT * 1/5) - holeDiameter/2;
@@ -403,13 +1033,38 @@ void updateLevel(){
   }
 }
 
+// Win screen: a firework every half second, spread over the screen in a fixed pattern
+void emitFireworks(){
+  if (wonTicks++ % (int)(SIMULATION_HZ / 2) != 0)
+    return;
+  int n = wonTicks / (int)(SIMULATION_HZ / 2);
+  const glm::vec4 colors[][2] = {
+    { glm::vec4(1.0f, 0.8f, 0.3f, 1.0f), glm::vec4(1.0f, 0.3f, 0.1f, 1.0f) },
+    { glm::vec4(0.4f, 0.8f, 1.0f, 1.0f), glm::vec4(0.6f, 0.3f, 1.0f, 1.0f) },
+    { glm::vec4(0.5f, 1.0f, 0.5f, 1.0f), glm::vec4(1.0f, 1.0f, 0.6f, 1.0f) } };
+  ParticleEmitter firework;
+  firework.Position = glm::vec2(SCR_WIDTH * (0.2f + 0.6f * glm::fract(n * 0.618f)), SCR_HEIGHT * (0.2f + 0.3f * glm::fract(n * 0.382f)));
+  firework.MinSpeed = 0.0f;
+  firework.MaxSpeed = 300.0f;
+  firework.MinLife = 1.5f;
+  firework.MaxLife = 3.0f;
+  firework.MinSize = 2.0f;
+  firework.MaxSize = 4.0f;
+  firework.ColorA = colors[n % 3][0];
+  firework.ColorB = colors[n % 3][1];
+  particles->Emit(firework, FIREWORK_PARTICLES);
+}
+
 void initStatusObjects(){
   status = menu;
+  wonTicks = 0;
+  level = 1;
   hoopCount = 0;
   mistakeCount = 0;
 
+  // speeds were tuned as 0.02 rad and 5 px per frame at 60 frames per second
   arrowRot = 0.0f;
-  arrowRotInc = 0.02f;
+  arrowRotInc = 0.02f * 60.0f / SIMULATION_HZ;
   arrowLength = (SCR_HEIGHT * 1/4);
   arrowWidth = (SCR_WIDTH * 1/10);
   arrowPosX = (SCR_WIDTH * 1/2) - arrowWidth/2;
@@ -417,7 +1072,7 @@ void initStatusObjects(){
 
   // Ball status
   ballPos;
-  ballPosInc = 5.0f;
+  ballPosInc = 5.0f * 60.0f / SIMULATION_HZ;
   ballRot;
   ballDiameter = (SCR_WIDTH * 1/14);
   ballPosX;
@@ -0,0 +1,13 @@
+#version 330 core
+in vec2 Corner;
+in vec4 ParticleColor;
+out vec4 color;
+
+void main()
+{
+    // round, soft edged point
+    float distance2 = dot(Corner, Corner);
+    if (distance2 > 1.0)
+        discard;
+    color = vec4(ParticleColor.rgb, ParticleColor.a * (1.0 - distance2));
+}
@@ -0,0 +1,24 @@
+#version 330 core
+// One instance per particle, the quad corners come from gl_VertexID (triangle strip of 4)
+layout (location = 0) in vec4 positionVelocity; // per instance <vec2 position, vec2 velocity>
+layout (location = 1) in vec3 lifeSize; // per instance <seconds left, lifetime, size>
+layout (location = 2) in vec4 color; // per instance
+
+out vec2 Corner;
+out vec4 ParticleColor;
+
+layout (std140) uniform FrameConstants
+{
+    mat4 projection;
+    vec4 viewport;
+    float time;
+};
+
+void main()
+{
+    Corner = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0 - 1.0;
+    // dead particles collapse to a point and produce no fragments
+    float size = lifeSize.x > 0.0 ? lifeSize.z : 0.0;
+    ParticleColor = vec4(color.rgb, color.a * clamp(lifeSize.x / lifeSize.y, 0.0, 1.0));
+    gl_Position = projection * vec4(positionVelocity.xy + Corner * 0.5 * size, 0.0, 1.0);
+}
@@ -0,0 +1,28 @@
+#version 330 core
+// Advances one particle by deltaTime; the result is captured by transform feedback
+layout (location = 0) in vec4 positionVelocity; // <vec2 position, vec2 velocity>
+layout (location = 1) in vec3 lifeSize; // <seconds left, lifetime, size>
+layout (location = 2) in uint color; // RGBA8, passed through
+
+out vec4 outPositionVelocity;
+out vec3 outLifeSize;
+flat out uint outColor;
+
+uniform float deltaTime;
+uniform vec2 gravity;
+uniform float drag;
+
+void main()
+{
+    vec4 particle = positionVelocity;
+    vec3 life = lifeSize;
+    if (life.x > 0.0)
+    {
+        life.x -= deltaTime;
+        particle.zw = particle.zw * max(0.0, 1.0 - drag * deltaTime) + gravity * deltaTime;
+        particle.xy += particle.zw * deltaTime;
+    }
+    outPositionVelocity = particle;
+    outLifeSize = life;
+    outColor = color;
+}
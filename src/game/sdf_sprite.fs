@@ -0,0 +1,41 @@
+#version 330 core
+in vec2 ShapeCoords;
+in vec3 SpriteColor;
+flat in uint Kind;
+flat in float Param;
+out vec4 color;
+
+uniform float alphaCutoff; // fragments below are discarded (cutout sprites)
+
+const uint SHAPE_CIRCLE = 0u;
+const uint SHAPE_RING = 1u;
+const uint SHAPE_GLOW = 2u;
+
+// Coverage of the pixel by the inside of the signed distance d, over about one pixel
+float coverage(float d)
+{
+    float width = max(fwidth(d), 1e-5);
+    return clamp(0.5 - d / width, 0.0, 1.0);
+}
+
+void main()
+{
+    float r = length(ShapeCoords);
+    vec3 rgb = SpriteColor;
+    float alpha;
+    if (Kind == SHAPE_RING)
+        alpha = coverage(abs(r - 1.0 + Param * 0.5) - Param * 0.5);
+    else if (Kind == SHAPE_GLOW)
+    {
+        float fade = 1.0 - clamp((r - Param) / max(1.0 - Param, 1e-5), 0.0, 1.0);
+        alpha = fade * fade;
+    }
+    else
+    {
+        alpha = coverage(r - 1.0);
+        rgb *= 1.0 - Param * r * r;
+    }
+    color = vec4(rgb, alpha);
+    if (color.a < alphaCutoff)
+        discard;
+}
@@ -0,0 +1,28 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 shape coordinates from -1 to 1>
+layout (location = 1) in vec3 color;
+layout (location = 2) in vec2 layerDepth; // <packed shape, window depth>
+
+out vec2 ShapeCoords;
+out vec3 SpriteColor;
+flat out uint Kind;
+flat out float Param;
+
+layout (std140) uniform FrameConstants
+{
+    mat4 projection;
+    vec4 viewport;
+    float time;
+};
+
+void main()
+{
+    // kind in the high bits, parameter in the low 16 (see SpriteShape::Packed)
+    uint shape = uint(layerDepth.x);
+    Kind = shape >> 16u;
+    Param = float(shape & 0xFFFFu) / 65535.0;
+    ShapeCoords = vertex.zw;
+    SpriteColor = color;
+    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+    gl_Position.z = layerDepth.y * 2.0 - 1.0;
+}
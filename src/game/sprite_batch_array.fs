@@ -0,0 +1,14 @@
+#version 330 core
+in vec3 TexCoords;
+in vec3 SpriteColor;
+out vec4 color;
+
+uniform float alphaCutoff; // fragments below are discarded (cutout sprites)
+uniform sampler2DArray image;
+
+void main()
+{
+    color = vec4(SpriteColor, 1.0) * texture(image, TexCoords);
+    if (color.a < alphaCutoff)
+        discard;
+}
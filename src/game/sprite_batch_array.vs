@@ -0,0 +1,22 @@
+#version 330 core
+layout (location = 0) in vec4 vertex; // <vec2 position, vec2 texCoords>
+layout (location = 1) in vec3 color;
+layout (location = 2) in vec2 layerDepth; // <texture array layer, window depth>
+
+out vec3 TexCoords; // <vec2 texCoords, layer>
+out vec3 SpriteColor;
+
+layout (std140) uniform FrameConstants
+{
+    mat4 projection;
+    vec4 viewport;
+    float time;
+};
+
+void main()
+{
+    TexCoords = vec3(vertex.zw, layerDepth.x);
+    SpriteColor = color;
+    gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
+    gl_Position.z = layerDepth.y * 2.0 - 1.0;
+}
@@ -0,0 +1,24 @@
+#version 330 core
+in vec2 TexCoords;
+in vec4 TextColor;
+out vec4 color;
+
+uniform sampler2D page;
+uniform float distanceRange; // texels over which the stored distance goes from 0 to 1
+uniform float outline; // band around the glyphs, in stored distance
+uniform vec4 outlineColor;
+
+void main()
+{
+    float distance = texture(page, TexCoords).r - 0.5;
+    // screen pixels per unit of stored distance, so the edge is a pixel wide at any scale
+    vec2 unitRange = vec2(distanceRange) / vec2(textureSize(page, 0));
+    float pixelRange = max(0.5 * dot(unitRange, vec2(1.0) / fwidth(TexCoords)), 1.0);
+    float fill = clamp(distance * pixelRange + 0.5, 0.0, 1.0);
+    float band = outline > 0.0 ? clamp((distance + outline) * pixelRange + 0.5, 0.0, 1.0) : 0.0;
+    // without a band the edge keeps the text color, blending it with black would darken it
+    vec3 edge = outline > 0.0 ? outlineColor.rgb : TextColor.rgb;
+    color = mix(vec4(edge, outlineColor.a * band), TextColor, fill);
+    if (color.a <= 0.0)
+        discard;
+}
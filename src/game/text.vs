@@ -0,0 +1,23 @@
+#version 330 core
+// One instance per glyph, the quad corners come from gl_VertexID (triangle strip of 4)
+layout (location = 0) in vec4 rect; // per instance <vec2 offset, vec2 extent>
+layout (location = 1) in vec4 uvRect; // per instance, same layout in the font page
+layout (location = 2) in vec4 color; // per instance
+
+out vec2 TexCoords;
+out vec4 TextColor;
+
+layout (std140) uniform FrameConstants
+{
+    mat4 projection;
+    vec4 viewport;
+    float time;
+};
+
+void main()
+{
+    vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+    TexCoords = uvRect.xy + corner * uvRect.zw;
+    TextColor = color;
+    gl_Position = projection * vec4(rect.xy + corner * rect.zw, 0.0, 1.0);
+}
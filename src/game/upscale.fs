@@ -0,0 +1,26 @@
+#version 330 core
+in vec2 TexCoords;
+out vec4 color;
+
+uniform sampler2D image;
+uniform float sharpness; // 0: plain bilinear, 1: strongest sharpening
+
+void main()
+{
+    vec4 center = texture(image, TexCoords);
+    if (sharpness <= 0.0)
+    {
+        color = center;
+        return;
+    }
+    // unsharp mask over the 4 neighbours, clamped to their range so edges do not ring
+    vec2 texel = 1.0 / vec2(textureSize(image, 0));
+    vec3 north = texture(image, TexCoords + vec2(0.0, texel.y)).rgb;
+    vec3 south = texture(image, TexCoords - vec2(0.0, texel.y)).rgb;
+    vec3 east = texture(image, TexCoords + vec2(texel.x, 0.0)).rgb;
+    vec3 west = texture(image, TexCoords - vec2(texel.x, 0.0)).rgb;
+    vec3 low = min(center.rgb, min(min(north, south), min(east, west)));
+    vec3 high = max(center.rgb, max(max(north, south), max(east, west)));
+    vec3 sharpened = center.rgb + (4.0 * center.rgb - north - south - east - west) * 0.25 * sharpness;
+    color = vec4(clamp(sharpened, low, high), center.a);
+}
@@ -0,0 +1,60 @@
+// Offline atlas packer: packs the given images into atlas pages and
+// writes <output>_<page>.tga plus the binary <output>.atlas index that
+// ResourceManager::LoadAtlas reads at startup.
+//
+//   atlas_packer [--page <width>x<height>] [--padding <pixels>] <output> <name>=<image> ...
+#include <glad/glad.h>
+
+#include <common/TextureAtlas.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static int usage()
+{
+	std::cout << "usage: atlas_packer [--page <width>x<height>] [--padding <pixels>] <output> <name>=<image> ..." << std::endl;
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	GLuint pageWidth = 1024, pageHeight = 1024, padding = 4;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		std::string option(argv[arg]);
+		if (option == "--page" && arg + 1 < argc)
+		{
+			if (std::sscanf(argv[++arg], "%ux%u", &pageWidth, &pageHeight) != 2)
+				return usage();
+		}
+		else if (option == "--padding" && arg + 1 < argc)
+			padding = (GLuint)std::atoi(argv[++arg]);
+		else
+			return usage();
+	}
+	if (argc - arg < 2)
+		return usage();
+	std::string output(argv[arg++]);
+
+	TextureAtlasBuilder builder(pageWidth, pageHeight, padding);
+	for (; arg < argc; ++arg)
+	{
+		std::string entry(argv[arg]);
+		size_t separator = entry.find('=');
+		if (separator == std::string::npos)
+			return usage();
+		if (!builder.AddFile(entry.substr(0, separator), entry.substr(separator + 1).c_str()))
+			return 1;
+	}
+	if (!builder.Build() || !builder.Save(output))
+		return 1;
+
+	for (std::map<std::string, AtlasRegion>::const_iterator it = builder.Regions.begin(); it != builder.Regions.end(); ++it)
+		std::cout << it->first << ": page " << it->second.Page << " at " << it->second.X << "," << it->second.Y
+			<< " size " << it->second.Width << "x" << it->second.Height << std::endl;
+	std::cout << builder.Pages.size() << " page(s) written to " << output << ".atlas" << std::endl;
+	return 0;
+}
@@ -0,0 +1,49 @@
+// Offline font builder: turns the built in 5x7 BitmapFont into a signed
+// distance field page and writes it, with the glyph metrics, as the
+// binary .font file that SdfFont::Load reads at startup.
+//
+//   font_builder [--texels <per font pixel>] [--spread <texels>] [--page <width>x<height>] <output.font>
+#include <glad/glad.h>
+
+#include <common/SdfFont.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+static int usage()
+{
+	std::cout << "usage: font_builder [--texels <per font pixel>] [--spread <texels>] [--page <width>x<height>] <output.font>" << std::endl;
+	return 1;
+}
+
+int main(int argc, char *argv[])
+{
+	GLuint texels = 8, spread = 6, pageWidth = 512, pageHeight = 512;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		std::string option(argv[arg]);
+		if (option == "--texels" && arg + 1 < argc)
+			texels = (GLuint)std::atoi(argv[++arg]);
+		else if (option == "--spread" && arg + 1 < argc)
+			spread = (GLuint)std::atoi(argv[++arg]);
+		else if (option == "--page" && arg + 1 < argc)
+		{
+			if (std::sscanf(argv[++arg], "%ux%u", &pageWidth, &pageHeight) != 2)
+				return usage();
+		}
+		else
+			return usage();
+	}
+	if (argc - arg != 1 || texels == 0 || spread == 0)
+		return usage();
+
+	SdfFontBuilder builder(texels, spread, pageWidth, pageHeight);
+	if (!builder.Build() || !builder.Save(argv[arg]))
+		return 1;
+	std::cout << builder.Glyphs.size() << " glyphs, " << texels << " texels per font pixel, distance range "
+		<< builder.DistanceRange() << " texels, written to " << argv[arg] << std::endl;
+	return 0;
+}
@@ -0,0 +1,110 @@
+// Golden-image comparison: compares a rendered snapshot (for example one
+// written by a headless run, game --headless) against a reference image.
+// A pixel mismatches when any channel differs by more than that
+// channel's tolerance; the comparison passes while the mismatching
+// pixels stay within --max-mismatch. Optionally writes a diff image with
+// the mismatches in red over the dimmed reference.
+//
+//   golden_compare [--tolerance <t>|<r>,<g>,<b>,<a>] [--max-mismatch <pixels>] [--diff <diff.png>] <expected> <actual>
+//
+// Exit code 0 when the images match, 1 when they differ, 2 on errors.
+#include <glad/glad.h>
+#include <stb_image.h>
+
+#include <common/PngWriter.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static int usage()
+{
+	std::cout << "usage: golden_compare [--tolerance <t>|<r>,<g>,<b>,<a>] [--max-mismatch <pixels>] [--diff <diff.png>] <expected> <actual>" << std::endl;
+	return 2;
+}
+
+int main(int argc, char *argv[])
+{
+	int tolerance[4] = { 0, 0, 0, 0 };
+	long maxMismatch = 0;
+	std::string diffPath;
+	int arg = 1;
+	for (; arg < argc && argv[arg][0] == '-'; ++arg)
+	{
+		std::string option(argv[arg]);
+		if (option == "--tolerance" && arg + 1 < argc)
+		{
+			int read = std::sscanf(argv[++arg], "%d,%d,%d,%d", &tolerance[0], &tolerance[1], &tolerance[2], &tolerance[3]);
+			if (read == 1)
+				tolerance[1] = tolerance[2] = tolerance[3] = tolerance[0];
+			else if (read != 4)
+				return usage();
+		}
+		else if (option == "--max-mismatch" && arg + 1 < argc)
+			maxMismatch = std::atol(argv[++arg]);
+		else if (option == "--diff" && arg + 1 < argc)
+			diffPath = argv[++arg];
+		else
+			return usage();
+	}
+	if (argc - arg != 2)
+		return usage();
+
+	int width, height, expectedWidth, expectedHeight, channels;
+	unsigned char *expected = stbi_load(argv[arg], &expectedWidth, &expectedHeight, &channels, 4);
+	unsigned char *actual = stbi_load(argv[arg + 1], &width, &height, &channels, 4);
+	if (!expected || !actual)
+	{
+		std::cout << "ERROR::GOLDEN_COMPARE: cannot load " << (expected ? argv[arg + 1] : argv[arg]) << std::endl;
+		return 2;
+	}
+	if (width != expectedWidth || height != expectedHeight)
+	{
+		std::cout << "FAIL: size " << width << "x" << height << " differs from the expected "
+			<< expectedWidth << "x" << expectedHeight << std::endl;
+		return 1;
+	}
+
+	size_t pixels = (size_t)width * height;
+	long mismatches = 0;
+	int maxDifference[4] = { 0, 0, 0, 0 };
+	double sumDifference[4] = { 0.0, 0.0, 0.0, 0.0 };
+	std::vector<unsigned char> diff(diffPath.empty() ? 0 : pixels * 4);
+	for (size_t i = 0; i < pixels; ++i)
+	{
+		bool mismatch = false;
+		for (int c = 0; c < 4; ++c)
+		{
+			int difference = std::abs((int)expected[i * 4 + c] - (int)actual[i * 4 + c]);
+			maxDifference[c] = std::max(maxDifference[c], difference);
+			sumDifference[c] += difference;
+			mismatch = mismatch || difference > tolerance[c];
+		}
+		if (mismatch)
+			mismatches++;
+		if (!diff.empty())
+		{
+			unsigned char gray = (unsigned char)((expected[i * 4] + expected[i * 4 + 1] + expected[i * 4 + 2]) / 12);
+			diff[i * 4 + 0] = mismatch ? 255 : gray;
+			diff[i * 4 + 1] = mismatch ? 0 : gray;
+			diff[i * 4 + 2] = mismatch ? 0 : gray;
+			diff[i * 4 + 3] = 255;
+		}
+	}
+	stbi_image_free(expected);
+	stbi_image_free(actual);
+
+	const char *names = "RGBA";
+	for (int c = 0; c < 4; ++c)
+		std::cout << names[c] << ": max difference " << maxDifference[c] << ", mean " << sumDifference[c] / pixels
+			<< ", tolerance " << tolerance[c] << std::endl;
+	if (!diff.empty() && !PngWriter::Write(diffPath.c_str(), width, height, 4, &diff[0]))
+		std::cout << "ERROR::GOLDEN_COMPARE: cannot write " << diffPath << std::endl;
+	bool pass = mismatches <= maxMismatch;
+	std::cout << (pass ? "PASS: " : "FAIL: ") << mismatches << " of " << pixels << " pixels outside the tolerance (at most "
+		<< maxMismatch << " allowed)" << std::endl;
+	return pass ? 0 : 1;
+}